@@ -1,6 +1,13 @@
 #include "GenerateTerrain.h"
 #include "MarchingCubeGen.h"
+#include "TerrainMeshComponent.h"
+#include "TerrainDestruct/Utils/ChunkEditStore.h"
+#include "TerrainDestruct/Utils/ChunkMeshCache.h"
 #include "Kismet/GameplayStatics.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Misc/CoreDelegates.h"
+#include "Async/Async.h"
+#include "TerrainDestruct/Utils/TerrainStats.h"
 
 // Constructor for the terrain generator
 AGenerateTerrain::AGenerateTerrain()
@@ -14,69 +21,413 @@ AGenerateTerrain::AGenerateTerrain()
 void AGenerateTerrain::BeginPlay()
 {
 	Super::BeginPlay();
+	// Every chunk reads the same config, saves and caches are keyed by its hash
+	WorldConfig = MakeWorldConfig();
+
+	// Saves made before they were keyed by the config belong to the world of the default noise settings
+	if (WorldConfig->IsLegacyWorld())
+	{
+		FChunkEditStore::MigrateLegacySaves(WorldConfig->Hash);
+	}
+
+	// Coarse nodes need to know which chunks have been edited in previous sessions of this world
+	FChunkEditStore::FindSavedChunks(WorldConfig->Hash, SavedChunks);
+
+	// Fit the mesh cache left by previous sessions in its budget
+	if (meshDiskCache)
+	{
+		FChunkMeshCache::SetBudget((int64)meshCacheBudgetMB * 1024 * 1024);
+		FChunkMeshCache::TrimAsync();
+	}
+	SampleCache = MakeShared<FTerrainSampleCache, ESPMode::ThreadSafe>();
+
+	// The recent chunk cache is the first thing to go when the platform runs low on memory
+	RecentChunks.SetBudget((SIZE_T)recentChunkCacheMB * 1024 * 1024);
+	MemoryTrimHandle = FCoreDelegates::GetMemoryTrimDelegate().AddUObject(this, &AGenerateTerrain::OnMemoryTrim);
+
+	// Build the octree around the chunk the player starts in
+	Octree.Configure(maxLod, lodRingSize, drawDistance);
+	LastPlayerChunk = GetPlayerChunk();
+	PredictedLocation = GetWorld()->GetFirstPlayerController()->GetPawn()->GetActorLocation();
+
 	// Generate the initial world
 	GenerateWorld();
 
 }
 
 
+// Called when the terrain is removed from the world
+void AGenerateTerrain::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	FCoreDelegates::GetMemoryTrimDelegate().Remove(MemoryTrimHandle);
+	Super::EndPlay(EndPlayReason);
+}
+
+// Release the data of the unloaded chunks, it can be regenerated
+void AGenerateTerrain::OnMemoryTrim()
+{
+	RecentChunks.Trim(0);
+}
+
+// Keep the mesh of a chunk being destroyed, so it comes back without any work if the player turns around
+void AGenerateTerrain::KeepRecentChunk(AMarchingCubeGen* Chunk)
+{
+	FChunkMeshCache::FKey key;
+	FRecentChunkCache::FEntry entry;
+	if (Chunk->ExportRecentEntry(key, entry))
+	{
+		RecentChunks.Add(key, MoveTemp(entry));
+	}
+}
+
+// Take back the data of an unloaded chunk in the same state, false if it has been dropped
+bool AGenerateTerrain::TakeRecentChunk(const FChunkMeshCache::FKey& Key, FRecentChunkCache::FEntry& OutEntry)
+{
+	return RecentChunks.Take(Key, OutEntry);
+}
+
 // Called every frame to update the game
 void AGenerateTerrain::Tick(float DeltaTime)
 {
+	SCOPE_CYCLE_COUNTER(STAT_TerrainTick);
+	TRACE_CPUPROFILER_EVENT_SCOPE(AGenerateTerrain::Tick);
+
 	Super::Tick(DeltaTime);
 
 	// Load pending chunks progressively (ChunkLoadPerFrame chunks per frame)
-	for (int i = 0; i < ChunkLoadPerFrame && !PendingChunks.IsEmpty(); ++i)
+	SpawnPendingChunks();
+
+	// Replaced nodes stay visible until the nodes covering their region have meshed
+	DestroyReplacedChunks();
+
+	// Split and merge nodes when the chunk the player is heading to changes
+	FIntVector PlayerChunk = GetPrefetchChunk(DeltaTime);
+	if (PlayerChunk != LastPlayerChunk)
 	{
-		FIntVector chunkCoords;
-		PendingChunks.Dequeue(chunkCoords);
-		SpawnChunkAt(chunkCoords);
+		LastPlayerChunk = PlayerChunk;
+		GenerateWorld();
 	}
 
-	// Get the current player position
-	FVector PlayerPos = GetWorld()->GetFirstPlayerController()->GetPawn()->GetActorLocation();
-	
-	// Unload chunks that are too far from the player
+	// Queue depths for "stat Terrain"
+	SET_DWORD_STAT(STAT_TerrainLoadedChunks, LoadedChunks.Num());
+	SET_DWORD_STAT(STAT_TerrainPendingChunks, PendingChunks.Num());
+	SET_DWORD_STAT(STAT_TerrainDeferredChunks, DeferredChunks.Num());
+	SET_DWORD_STAT(STAT_TerrainRetiringChunks, RetiringChunks.Num());
+	SET_DWORD_STAT(STAT_TerrainRecentChunks, RecentChunks.Num());
+	SET_MEMORY_STAT(STAT_TerrainRecentChunkMemory, RecentChunks.GetAllocatedSize());
+}
+
+
+
+// Update the octree around the player and load or unload the nodes that changed
+void AGenerateTerrain::GenerateWorld()
+{
+	SCOPE_CYCLE_COUNTER(STAT_TerrainUpdateOctree);
+	TRACE_CPUPROFILER_EVENT_SCOPE(AGenerateTerrain::GenerateWorld);
+
+	Octree.Update(LastPlayerChunk);
+	const TSet<FTerrainNodeKey>& leaves = Octree.GetLeaves();
+
+	// Unload nodes that were merged into a parent, split into children or left the view range
 	for (auto it = LoadedChunks.CreateIterator(); it; ++it)
 	{
-		if (it.Value() && FVector::Dist(it.Value()->GetActorLocation(), PlayerPos) > drawDistance * size * 100)
+		if (!leaves.Contains(it.Key()))
 		{
-			it.Value()->Destroy();
+			if (it.Value())
+			{
+				RetiringChunks.Add(it.Value());
+			}
+			SolidNodes.Remove(it.Key());
 			it.RemoveCurrent();
 		}
 	}
 
-	// Continuously generate chunks around the player
-	GenerateWorld();
+	// Drop the pending nodes that are no longer needed, a mispredicted prefetch costs nothing until it is spawned
+	PendingChunks.RemoveAllSwap([this](const FTerrainNodeKey& node) { return !LoadedChunks.Contains(node); });
+
+	// Solid nodes may have been unloaded, deferred nodes are checked again when they are picked
+	RestoreDeferredChunks();
+
+	for (const FTerrainNodeKey& node : leaves)
+	{
+		// If the node has not been generated yet, add it to the queue
+		if (!LoadedChunks.Contains(node))
+		{
+			// A node coming back before its replacements were spawned, after a mispredicted prefetch, keeps its chunk
+			if (AMarchingCubeGen* chunk = ReclaimRetiringChunk(node))
+			{
+				LoadedChunks.Add(node, chunk);
+				chunk->SetTransitionFaces(Octree.GetTransitionFaces(node));
+				if (chunk->IsSolid())
+				{
+					SolidNodes.Add(node);
+				}
+				continue;
+			}
+
+			PendingChunks.Add(node);
+			LoadedChunks.Add(node, nullptr);
+		}
+		// Otherwise only its neighbours may have changed level
+		else if (AMarchingCubeGen* chunk = LoadedChunks[node])
+		{
+			chunk->SetTransitionFaces(Octree.GetTransitionFaces(node));
+		}
+	}
 }
 
+// Move an edited chunk to the front of the edited chunk cache, evicting the oldest one
+void AGenerateTerrain::TouchEditedChunk(AMarchingCubeGen* Chunk)
+{
+	// Coarse nodes covering this chunk will have to gather its modifications
+	SavedChunks.Add(Chunk->GetChunkCoord());
 
+	TWeakObjectPtr<AMarchingCubeGen> chunkPtr(Chunk);
+	RecentlyEditedChunks.Remove(chunkPtr);
+	RecentlyEditedChunks.Insert(chunkPtr, 0);
 
-// Generate all chunks around the player within a radius of drawDistance
-void AGenerateTerrain::GenerateWorld()
+	// Chunks falling out of the cache drop their density grid, it will be rebuilt from noise on the next edit
+	while (RecentlyEditedChunks.Num() > FMath::Max(EditedChunkCacheSize, 1))
+	{
+		if (AMarchingCubeGen* evicted = RecentlyEditedChunks.Pop().Get())
+		{
+			evicted->ReleaseDensity();
+		}
+	}
+}
+
+// Spawn the ChunkLoadPerFrame pending nodes the player is the most likely to see soon:
+// the closest ones first, nodes outside the camera view later, nodes enclosed by solid nodes not at all
+void AGenerateTerrain::SpawnPendingChunks()
+{
+	SCOPE_CYCLE_COUNTER(STAT_TerrainSpawnChunks);
+	TRACE_CPUPROFILER_EVENT_SCOPE(AGenerateTerrain::SpawnPendingChunks);
+
+	if (PendingChunks.Num() == 0)
+		return;
+
+	// Camera of the player
+	APlayerController* controller = GetWorld()->GetFirstPlayerController();
+	FVector viewLocation;
+	FRotator viewRotation;
+	controller->GetPlayerViewPoint(viewLocation, viewRotation);
+	const float fov = controller->PlayerCameraManager ? controller->PlayerCameraManager->GetFOVAngle() : 90.0f;
+	const float halfFov = FMath::DegreesToRadians(fov * 0.5f);
+
+	TArray<float> priorities;
+	priorities.SetNumUninitialized(PendingChunks.Num());
+	for (int i = 0; i < PendingChunks.Num(); ++i)
+	{
+		priorities[i] = GetLoadPriority(PendingChunks[i], viewLocation, viewRotation.Vector(), halfFov);
+	}
+
+	int spawned = 0;
+	while (spawned < ChunkLoadPerFrame && PendingChunks.Num() > 0)
+	{
+		// Lowest priority value first, only a few nodes are picked per frame so a linear search is enough
+		int best = 0;
+		for (int i = 1; i < priorities.Num(); ++i)
+		{
+			if (priorities[i] < priorities[best])
+				best = i;
+		}
+
+		const FTerrainNodeKey node = PendingChunks[best];
+		PendingChunks.RemoveAtSwap(best, EAllowShrinking::No);
+		priorities.RemoveAtSwap(best, EAllowShrinking::No);
+
+		// Skip nodes merged or split away while they were waiting, or queued twice
+		AMarchingCubeGen** existing = LoadedChunks.Find(node);
+		if (!existing || *existing || GatheringNodes.Contains(node))
+			continue;
+
+		// Nothing can be seen inside solid ground, wait until it is dug into
+		if (IsEnclosedBySolidNodes(node))
+		{
+			DeferredChunks.Add(node);
+			continue;
+		}
+
+		SpawnChunkAt(node);
+		++spawned;
+	}
+}
+
+// Load priority of a node, lower loads first: distance in chunks from the path between the camera and the
+// predicted player location, scaled up outside the view cone
+float AGenerateTerrain::GetLoadPriority(const FTerrainNodeKey& Node, const FVector& ViewLocation, const FVector& ViewDirection, float HalfFov) const
+{
+	const float chunkWorldSize = size * 100.0f;
+	const float nodeWorldSize = chunkWorldSize * Node.GetChunkSpan();
+	const FVector center = FVector(Node.GetMinChunk()) * chunkWorldSize + FVector(nodeWorldSize * 0.5f);
+	const float radius = nodeWorldSize * 0.866f; // half diagonal of the node
+
+	const FVector toNode = center - ViewLocation;
+	const float distance = toNode.Size();
+	const float pathDistance = FMath::PointDistToSegment(center, ViewLocation, PredictedLocation);
+	float priority = FMath::Max(pathDistance - radius, 0.0f) / chunkWorldSize;
+
+	// The player has to turn before seeing nodes outside the view cone
+	if (distance > radius)
+	{
+		const float angle = FMath::Acos(FMath::Clamp(FVector::DotProduct(toNode / distance, ViewDirection), -1.0f, 1.0f));
+		const float angularRadius = FMath::Asin(radius / distance);
+		if (angle - angularRadius > HalfFov)
+		{
+			priority = (priority + 1.0f) * OutOfViewPriorityScale;
+		}
+	}
+
+	return priority;
+}
+
+// True when every leaf touching one of the six faces of a node is solid ground, whatever its level
+bool AGenerateTerrain::IsEnclosedBySolidNodes(const FTerrainNodeKey& Node) const
 {
-	// Get the coordinates of the chunk in which the player is located
-	FIntVector PlayerChunk = GetPlayerChunk();
+	const int32 span = Node.GetChunkSpan();
+	const FIntVector minChunk = Node.GetMinChunk();
 
-	// Iterate through all chunks within the drawDistance radius
-	for (int x = -drawDistance; x <= drawDistance; x++)
+	for (int32 face = 0; face < 6; ++face)
 	{
-		for (int y = -drawDistance; y <= drawDistance; y++)
+		const int32 axis = face / 2;
+		const int32 uAxis = (axis + 1) % 3;
+		const int32 vAxis = (axis + 2) % 3;
+
+		// Check every chunk just across the face, finer neighbours only cover part of it
+		FTerrainNodeKey lastLeaf(-1, FIntVector::ZeroValue);
+		for (int32 u = 0; u < span; ++u)
 		{
-			for (int z = -drawDistance; z <= drawDistance; z++)
+			for (int32 v = 0; v < span; ++v)
 			{
-				// Calculate the coordinates of the chunk to be generated
-				FIntVector chunkCoords = PlayerChunk + FIntVector(x, y, z);
-				
-				// If the chunk has not been generated yet, add it to the queue
-				if (!LoadedChunks.Contains(chunkCoords))
-				{
-					PendingChunks.Enqueue(chunkCoords);
-					LoadedChunks.Add(chunkCoords, nullptr); 
-				}
+				FIntVector neighbour = minChunk;
+				neighbour[axis] += (face & 1) ? span : -1;
+				neighbour[uAxis] += u;
+				neighbour[vAxis] += v;
+
+				// Out of view space is not ground that hides anything
+				FTerrainNodeKey leaf;
+				if (!Octree.FindLeaf(neighbour, leaf))
+					return false;
+
+				// A coarser neighbour covers many of these chunks in a row
+				if (leaf == lastLeaf)
+					continue;
+
+				if (!SolidNodes.Contains(leaf))
+					return false;
+				lastLeaf = leaf;
 			}
 		}
 	}
+	return true;
+}
+
+// Put the deferred nodes back in the pending list, they are deferred again if still enclosed
+void AGenerateTerrain::RestoreDeferredChunks()
+{
+	PendingChunks.Append(DeferredChunks.Array());
+	DeferredChunks.Reset();
+}
+
+// Track which chunks are entirely underground after each mesh, they hide the chunks they enclose
+void AGenerateTerrain::OnChunkMeshed(AMarchingCubeGen* Chunk)
+{
+	const FTerrainNodeKey node(Chunk->lod, Chunk->GetChunkCoord());
+	if (Chunk->IsSolid())
+	{
+		SolidNodes.Add(node);
+	}
+	else if (SolidNodes.Remove(node) > 0)
+	{
+		// Dug into: the nodes it was hiding may be visible now
+		RestoreDeferredChunks();
+	}
+}
+
+// Draw a chunk's meshes through the render batch of its 2x2x2 block of sibling nodes
+void AGenerateTerrain::SetChunkMesh(AMarchingCubeGen* Chunk, const FSharedMeshData& Surface, const FSharedMeshData& Caps)
+{
+	const FTerrainNodeKey node(Chunk->lod, Chunk->GetChunkCoord());
+	const FTerrainNodeKey batchKey = GetBatchKey(node);
+
+	FRenderBatch& batch = RenderBatches.FindOrAdd(batchKey);
+	if (!batch.Component)
+	{
+		// One component per block, placed at the block's first chunk
+		const FIntVector minChunk = batchKey.GetMinChunk();
+		batch.Component = NewObject<UTerrainMeshComponent>(this);
+		batch.Component->SetupAttachment(GetRootComponent());
+		batch.Component->SetUsingAbsoluteLocation(true);
+		batch.Component->SetUsingAbsoluteRotation(true);
+		batch.Component->SetUsingAbsoluteScale(true);
+		batch.Component->SetWorldLocation(FVector(minChunk.X * size * 100, minChunk.Y * size * 100, minChunk.Z * size * 100));
+
+		// Collision stays on the chunks, disable shadow casting for performance optimization
+		batch.Component->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		batch.Component->SetCastShadow(false);
+		batch.Component->SetMaterial(0, material);
+		batch.Component->RegisterComponent();
+		AddInstanceComponent(batch.Component);
+	}
+
+	// Every node of the block owns two sections: its surface and its transition caps
+	const int32 slot = GetBatchSlot(node);
+	batch.Slots[slot] = Chunk;
+	const FVector3f offset(Chunk->GetActorLocation() - batch.Component->GetComponentLocation());
+
+	// Only this chunk's range of the batch buffers is rewritten
+	batch.Component->UpdateSection(slot * 2, Surface, false, offset);
+	if (Caps.IsValid() && Caps->Triangles.Num() > 0)
+	{
+		batch.Component->UpdateSection(slot * 2 + 1, Caps, false, offset);
+	}
+	else
+	{
+		batch.Component->ClearSection(slot * 2 + 1);
+	}
+}
+
+// Remove a chunk's meshes from its render batch, destroying the batch once it is empty
+void AGenerateTerrain::RemoveChunkMesh(AMarchingCubeGen* Chunk)
+{
+	const FTerrainNodeKey node(Chunk->lod, Chunk->GetChunkCoord());
+	const FTerrainNodeKey batchKey = GetBatchKey(node);
+	const int32 slot = GetBatchSlot(node);
+
+	// The slot may already belong to a new chunk of the same node
+	FRenderBatch* batch = RenderBatches.Find(batchKey);
+	if (!batch || batch->Slots[slot] != TWeakObjectPtr<AMarchingCubeGen>(Chunk))
+		return;
+
+	batch->Slots[slot].Reset();
+	for (const TWeakObjectPtr<AMarchingCubeGen>& other : batch->Slots)
+	{
+		if (other.IsValid())
+		{
+			batch->Component->ClearSection(slot * 2);
+			batch->Component->ClearSection(slot * 2 + 1);
+			return;
+		}
+	}
+
+	if (IsValid(batch->Component))
+	{
+		batch->Component->DestroyComponent();
+	}
+	RenderBatches.Remove(batchKey);
+}
+
+// Batch of a node: the node of the next level containing it
+FTerrainNodeKey AGenerateTerrain::GetBatchKey(const FTerrainNodeKey& Node)
+{
+	// Shifting floors the division, nodes left of or below the origin have negative coordinates
+	return FTerrainNodeKey(Node.Level + 1, FIntVector(Node.Coord.X >> 1, Node.Coord.Y >> 1, Node.Coord.Z >> 1));
+}
+
+// Position of a node in its batch, 0 to 7
+int32 AGenerateTerrain::GetBatchSlot(const FTerrainNodeKey& Node)
+{
+	return (Node.Coord.X & 1) | ((Node.Coord.Y & 1) << 1) | ((Node.Coord.Z & 1) << 2);
 }
 
 // Returns the coordinates of the chunk in which the player is located
@@ -93,11 +444,206 @@ FIntVector AGenerateTerrain::GetPlayerChunk() const
 	return FIntVector(cx, cy, cz);
 }
 
-// Creates and initializes a chunk at the specified coordinates
-void AGenerateTerrain::SpawnChunkAt(const FIntVector& chunkCoords)
+// Chunk the octree is centered on: where the player will be in PrefetchTime seconds, extrapolated from the
+// velocity and acceleration of its pawn. It stays within lodRingSize chunks of the player chunk, so the player
+// is always in a full resolution chunk
+FIntVector AGenerateTerrain::GetPrefetchChunk(float DeltaTime)
+{
+	const FIntVector playerChunk = GetPlayerChunk();
+	APawn* pawn = GetWorld()->GetFirstPlayerController()->GetPawn();
+	const FVector velocity = pawn->GetVelocity();
+
+	// Acceleration from the velocity change, smoothed so a single frame of input doesn't move the octree
+	if (DeltaTime > 0.0f)
+	{
+		PawnAcceleration = FMath::Lerp(PawnAcceleration, (velocity - LastPawnVelocity) / DeltaTime, FMath::Min(DeltaTime * 10.0f, 1.0f));
+	}
+	LastPawnVelocity = velocity;
+
+	FVector displacement = velocity * PrefetchTime + 0.5f * PawnAcceleration * PrefetchTime * PrefetchTime;
+	// Braking doesn't send the player backwards
+	if (FVector::DotProduct(displacement, velocity) < 0.0f)
+	{
+		displacement = FVector::ZeroVector;
+	}
+	PredictedLocation = pawn->GetActorLocation() + displacement;
+
+	const float chunkWorldSize = size * 100.0f;
+	const int32 maxOffset = FMath::Max(lodRingSize - 1, 0);
+	const FIntVector predictedChunk(
+		FMath::FloorToInt(PredictedLocation.X / chunkWorldSize),
+		FMath::FloorToInt(PredictedLocation.Y / chunkWorldSize),
+		FMath::FloorToInt(PredictedLocation.Z / chunkWorldSize)
+	);
+
+	return FIntVector(
+		playerChunk.X + FMath::Clamp(predictedChunk.X - playerChunk.X, -maxOffset, maxOffset),
+		playerChunk.Y + FMath::Clamp(predictedChunk.Y - playerChunk.Y, -maxOffset, maxOffset),
+		playerChunk.Z + FMath::Clamp(predictedChunk.Z - playerChunk.Z, -maxOffset, maxOffset)
+	);
+}
+
+// Take back the chunk of a node that was retired but not destroyed yet
+AMarchingCubeGen* AGenerateTerrain::ReclaimRetiringChunk(const FTerrainNodeKey& Node)
 {
-	// Calculate the world position based on chunk coordinates
-	FVector WorldPos = FVector(chunkCoords.X * size * 100, chunkCoords.Y * size * 100, chunkCoords.Z * size * 100);
+	for (int i = 0; i < RetiringChunks.Num(); ++i)
+	{
+		AMarchingCubeGen* chunk = RetiringChunks[i];
+		if (IsValid(chunk) && chunk->lod == Node.Level && chunk->GetChunkCoord() == Node.Coord)
+		{
+			RetiringChunks.RemoveAtSwap(i);
+			return chunk;
+		}
+	}
+	return nullptr;
+}
+
+// Destroy the retiring chunks whose region is covered by meshed leaves again, each one as soon as it is
+void AGenerateTerrain::DestroyReplacedChunks()
+{
+	for (int i = RetiringChunks.Num() - 1; i >= 0; --i)
+	{
+		AMarchingCubeGen* chunk = RetiringChunks[i];
+		if (!IsValid(chunk))
+		{
+			RetiringChunks.RemoveAtSwap(i);
+		}
+		else if (IsRegionMeshed(FTerrainNodeKey(chunk->lod, chunk->GetChunkCoord())))
+		{
+			chunk->Destroy();
+			RetiringChunks.RemoveAtSwap(i);
+		}
+	}
+}
+
+// True when every leaf overlapping the node's region has a mesh, parts out of view need none
+bool AGenerateTerrain::IsRegionMeshed(const FTerrainNodeKey& Node) const
+{
+	// A leaf as coarse as the node or coarser covers it entirely
+	FTerrainNodeKey leaf;
+	const bool bInView = Octree.FindLeaf(Node.GetMinChunk(), leaf);
+	if (bInView && leaf.Level >= Node.Level)
+	{
+		return IsLeafMeshed(leaf);
+	}
+
+	// A level 0 chunk out of view needs no mesh, a coarser node may still be partly in view
+	if (Node.Level == 0)
+	{
+		return true;
+	}
+
+	// Otherwise the node was split or partly left the view, each of its children must be covered
+	for (int32 i = 0; i < 8; ++i)
+	{
+		const FIntVector child = Node.Coord * 2 + FIntVector(i & 1, (i >> 1) & 1, (i >> 2) & 1);
+		if (!IsRegionMeshed(FTerrainNodeKey(Node.Level - 1, child)))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// True when a leaf's chunk has a mesh, or when it has none to show because it is enclosed by solid nodes
+bool AGenerateTerrain::IsLeafMeshed(const FTerrainNodeKey& Leaf) const
+{
+	AMarchingCubeGen* const* chunk = LoadedChunks.Find(Leaf);
+	if (chunk && *chunk)
+	{
+		return (*chunk)->HasMesh();
+	}
+	return DeferredChunks.Contains(Leaf);
+}
+
+// Build the generation config from the properties of the terrain
+FTerrainWorldConfigPtr AGenerateTerrain::MakeWorldConfig() const
+{
+	static const FastNoiseLite::NoiseType noiseTypes[] = {
+		FastNoiseLite::NoiseType_Perlin,
+		FastNoiseLite::NoiseType_OpenSimplex2,
+		FastNoiseLite::NoiseType_OpenSimplex2S,
+		FastNoiseLite::NoiseType_Cellular,
+		FastNoiseLite::NoiseType_Value,
+		FastNoiseLite::NoiseType_ValueCubic
+	};
+
+	TSharedRef<FTerrainWorldConfig, ESPMode::ThreadSafe> config = MakeShared<FTerrainWorldConfig, ESPMode::ThreadSafe>();
+	config->Seed = seed;
+	config->NoiseType = noiseTypes[(uint8)noiseType];
+	config->Frequency = frequency;
+	config->Octaves = octaves;
+	config->Lacunarity = lacunarity;
+	config->Gain = gain;
+	config->SurfaceLevel = surfaceLevel;
+	config->ChunkSize = size;
+	config->bHeightfieldDensity = heightfieldDensity;
+	config->HeightAmplitude = heightAmplitude;
+	config->DetailAmplitude = detailAmplitude;
+	config->Finalize();
+	return config;
+}
+
+// Creates the chunk of an octree node. A coarse node covering edited chunks first reads their save files
+// on a worker thread, and is created once they arrive
+void AGenerateTerrain::SpawnChunkAt(const FTerrainNodeKey& Node)
+{
+	TArray<FIntVector> savedChildren;
+	if (Node.Level > 0)
+	{
+		const FIntVector minChunk = Node.GetMinChunk();
+		const int span = Node.GetChunkSpan();
+		for (const FIntVector& savedChunk : SavedChunks)
+		{
+			const FIntVector child = savedChunk - minChunk;
+			if (child.X >= 0 && child.Y >= 0 && child.Z >= 0 && child.X < span && child.Y < span && child.Z < span)
+			{
+				savedChildren.Add(savedChunk);
+			}
+		}
+	}
+
+	if (savedChildren.Num() == 0)
+	{
+		CreateChunk(Node, TMap<FIntVector, float>());
+		return;
+	}
+
+	GatheringNodes.Add(Node);
+	Async(EAsyncExecution::ThreadPool, [WeakThis = TWeakObjectPtr<AGenerateTerrain>(this), WorldHash = WorldConfig->Hash, ChunkSize = size, Node, savedChildren = MoveTemp(savedChildren)]()
+	{
+		TMap<FIntVector, float> modifications;
+		GatherModifications(WorldHash, ChunkSize, Node, savedChildren, modifications);
+
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, Node, modifications = MoveTemp(modifications)]() mutable
+		{
+			if (AGenerateTerrain* terrain = WeakThis.Get())
+			{
+				terrain->OnModificationsGathered(Node, MoveTemp(modifications));
+			}
+		});
+	});
+}
+
+// Create the chunk of a coarse node once the modifications of the chunks it covers have been read
+void AGenerateTerrain::OnModificationsGathered(const FTerrainNodeKey& Node, TMap<FIntVector, float>&& Modifications)
+{
+	GatheringNodes.Remove(Node);
+
+	// The node may have been merged or split away, or spawned by an earlier gather, while the files were read
+	AMarchingCubeGen** existing = LoadedChunks.Find(Node);
+	if (!existing || *existing)
+		return;
+
+	CreateChunk(Node, MoveTemp(Modifications));
+}
+
+// Spawn and initialize the chunk of an octree node, coarse nodes receive the modifications gathered for them
+void AGenerateTerrain::CreateChunk(const FTerrainNodeKey& node, TMap<FIntVector, float>&& Modifications)
+{
+	// Calculate the world position based on the first chunk covered by the node
+	const FIntVector minChunk = node.GetMinChunk();
+	FVector WorldPos = FVector(minChunk.X * size * 100, minChunk.Y * size * 100, minChunk.Z * size * 100);
 	FTransform transform(FRotator::ZeroRotator, WorldPos, FVector::OneVector);
 
 	// Create the chunk deferred to avoid BeginPlay being called before initialization
@@ -107,14 +653,60 @@ void AGenerateTerrain::SpawnChunkAt(const FIntVector& chunkCoords)
 		this
 	);
 
-	// Initialize chunk parameters
-	chunk->frequency = frequency;
-	chunk->material = material;
-	chunk->size = size;
-	chunk->surfaceLevel = surfaceLevel;
-	chunk->LoadModifications();
+	// Initialize chunk parameters, a node of level L covers 2^L chunks sampled every 2^L voxels
+	chunk->config = WorldConfig;
+	chunk->size = size * node.GetChunkSpan();
+	chunk->debugColors = debugColors;
+	chunk->sampleCache = SampleCache;
+	chunk->useMeshCache = meshDiskCache;
+	chunk->lod = node.Level;
+	chunk->transitionFaces = Octree.GetTransitionFaces(node);
+	if (node.Level == 0)
+	{
+		chunk->LoadModifications();
+	}
+	else
+	{
+		chunk->modifications = MoveTemp(Modifications);
+	}
 	
 	// Finalize chunk creation and add it to the world
 	UGameplayStatics::FinishSpawningActor(chunk, transform);
-	LoadedChunks[chunkCoords] = chunk;
-}
\ No newline at end of file
+	LoadedChunks[node] = chunk;
+}
+
+// Build the modifications of a coarse node from the save files of the chunks it covers, on a worker thread
+void AGenerateTerrain::GatherModifications(uint32 WorldHash, int32 ChunkSize, const FTerrainNodeKey& Node, const TArray<FIntVector>& SavedChildren, TMap<FIntVector, float>& OutModifications)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TerrainGatherEdits);
+	TRACE_CPUPROFILER_EVENT_SCOPE(AGenerateTerrain::GatherModifications);
+
+	const FIntVector minChunk = Node.GetMinChunk();
+	const int span = Node.GetChunkSpan();
+	const int nodeSize = ChunkSize * span;
+
+	for (const FIntVector& savedChunk : SavedChildren)
+	{
+		const FIntVector child = savedChunk - minChunk;
+
+		TMap<FIntVector, float> childModifications;
+		if (!FChunkEditStore::Load(FChunkEditStore::GetChunkFileName(WorldHash, savedChunk), childModifications))
+			continue;
+
+		// Move the voxels into the node's space, keeping those on its coarse grid
+		for (const auto& pair : childModifications)
+		{
+			const FIntVector voxel = child * ChunkSize + pair.Key;
+			if (voxel.X < 0 || voxel.Y < 0 || voxel.Z < 0 || voxel.X > nodeSize || voxel.Y > nodeSize || voxel.Z > nodeSize)
+				continue;
+			if (voxel.X % span != 0 || voxel.Y % span != 0 || voxel.Z % span != 0)
+				continue;
+
+			// Chunks sharing a border layer both store it, keep the first one
+			if (!OutModifications.Contains(voxel))
+			{
+				OutModifications.Add(voxel, pair.Value);
+			}
+		}
+	}
+}
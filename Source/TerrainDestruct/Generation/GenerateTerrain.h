@@ -3,10 +3,29 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "TerrainDestruct/Utils/TerrainOctree.h"
+#include "TerrainDestruct/Utils/MeshData.h"
+#include "TerrainDestruct/Utils/TerrainSampleCache.h"
+#include "TerrainDestruct/Utils/TerrainWorldConfig.h"
+#include "TerrainDestruct/Utils/RecentChunkCache.h"
 #include "GenerateTerrain.generated.h"
 
 
 class AMarchingCubeGen;
+class UTerrainMeshComponent;
+
+// Noise types of FastNoiseLite usable for the terrain density
+UENUM()
+enum class ETerrainNoiseType : uint8
+{
+	Perlin,
+	OpenSimplex2,
+	OpenSimplex2S,
+	Cellular,
+	Value,
+	ValueCubic
+};
+
 UCLASS()
 class TERRAINDESTRUCT_API AGenerateTerrain : public AActor
 {
@@ -24,6 +43,23 @@ public:
 	
 	UPROPERTY(EditInstanceOnly, Category="Generation")
 	float frequency = 0.03f;
+
+	// Seed of the noise, the same config always generates the same world
+	UPROPERTY(EditInstanceOnly, Category="Generation")
+	int32 seed = 1337;
+
+	UPROPERTY(EditInstanceOnly, Category="Generation")
+	ETerrainNoiseType noiseType = ETerrainNoiseType::Perlin;
+
+	// Fractal layers of the noise, each one lacunarity times finer and gain times weaker than the previous
+	UPROPERTY(EditInstanceOnly, Category="Generation", meta=(ClampMin=1))
+	int32 octaves = 3;
+
+	UPROPERTY(EditInstanceOnly, Category="Generation")
+	float lacunarity = 2.0f;
+
+	UPROPERTY(EditInstanceOnly, Category="Generation")
+	float gain = 0.5f;
 	
 	UPROPERTY(EditInstanceOnly, Category="Generation")
 	int size = 16;
@@ -31,23 +67,153 @@ public:
 	UPROPERTY(EditInstanceOnly, Category="Generation")
 	TObjectPtr<UMaterialInterface> material;
 
+	// Random vertex colors to see the chunks and triangles, chunks store no vertex colors when off
+	UPROPERTY(EditInstanceOnly, Category="Generation")
+	bool debugColors = true;
+
+	// Build the density from a 2D heightfield, cached per column of chunks, plus a cheap 3D detail noise.
+	// Much fewer noise samples than the default full 3D noise, but no overhangs besides the detail
+	UPROPERTY(EditInstanceOnly, Category="Generation")
+	bool heightfieldDensity = false;
+
+	// Height range of the heightfield in voxels
+	UPROPERTY(EditInstanceOnly, Category="Generation", meta=(EditCondition="heightfieldDensity"))
+	float heightAmplitude = 32.0f;
+
+	// Strength of the 3D detail noise, the heightfield density changes by 1 every heightAmplitude voxels
+	UPROPERTY(EditInstanceOnly, Category="Generation", meta=(EditCondition="heightfieldDensity"))
+	float detailAmplitude = 0.3f;
+
 
-	TMap<FIntVector, AMarchingCubeGen*> LoadedChunks;
+	// Chunk actor of every octree leaf, null while it waits in PendingChunks
+	TMap<FTerrainNodeKey, AMarchingCubeGen*> LoadedChunks;
 
 	UPROPERTY(EditAnywhere)
 	int32 ChunkLoadPerFrame = 4;  // How many chunks to spawn per frame
 
-	TQueue<FIntVector> PendingChunks; // Queue of chunks to generate
+	TArray<FTerrainNodeKey> PendingChunks; // Chunks to generate, the ones the player is most likely to see go first
+
+	// Pending chunks outside the camera view wait as if they were this many times farther away
+	UPROPERTY(EditAnywhere, Category="Generation")
+	float OutOfViewPriorityScale = 4.0f;
+
+	// Seconds of movement predicted ahead of the player: the octree is centered where the player is heading,
+	// so the chunks along the way are generated before they are reached. 0 turns prefetching off
+	UPROPERTY(EditAnywhere, Category="Generation")
+	float PrefetchTime = 1.0f;
+
+	// Keep the generated chunk meshes on disk, under Saved/TerrainMeshCache, and load them when coming back
+	UPROPERTY(EditAnywhere, Category="Generation")
+	bool meshDiskCache = true;
+
+	// Disk space of the mesh cache in megabytes, the least recently used meshes are deleted past it
+	UPROPERTY(EditAnywhere, Category="Generation", meta=(EditCondition="meshDiskCache", ClampMin=0))
+	int32 meshCacheBudgetMB = 512;
+
+	// Memory in megabytes kept for the meshes of recently unloaded chunks, restored instantly when they come back
+	UPROPERTY(EditAnywhere, Category="Generation", meta=(ClampMin=0))
+	int32 recentChunkCacheMB = 64;
+
+	// How many recently edited chunks keep their density grid in memory
+	UPROPERTY(EditAnywhere, Category="Generation")
+	int32 EditedChunkCacheSize = 8;
+
+	// A node of level L is split into 8 finer nodes while the player is closer than lodRingSize * 2^L chunks
+	UPROPERTY(EditInstanceOnly, Category="Generation")
+	int lodRingSize = 2;
+
+	// Level of the octree roots, they span 2^maxLod chunks and sample every 2^maxLod voxels
+	UPROPERTY(EditInstanceOnly, Category="Generation")
+	int maxLod = 3;
+
+	// Move an edited chunk to the front of the edited chunk cache, evicting the oldest one
+	void TouchEditedChunk(AMarchingCubeGen* Chunk);
+
+	// Draw a chunk's meshes through the render batch of its 2x2x2 block of sibling nodes
+	void SetChunkMesh(AMarchingCubeGen* Chunk, const FSharedMeshData& Surface, const FSharedMeshData& Caps);
+	// Remove a chunk's meshes from its render batch, destroying the batch once it is empty
+	void RemoveChunkMesh(AMarchingCubeGen* Chunk);
+	// Track which chunks are entirely underground after each mesh, they hide the chunks they enclose
+	void OnChunkMeshed(AMarchingCubeGen* Chunk);
+
+	// Recent chunk cache: unloaded chunks leave their data, respawned chunks take it back
+	void KeepRecentChunk(AMarchingCubeGen* Chunk);
+	bool TakeRecentChunk(const FChunkMeshCache::FKey& Key, FRecentChunkCache::FEntry& OutEntry);
 
 
 	
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	virtual void Tick(float DeltaTime) override;
 
 private:
+	// Recently edited chunks, most recent first
+	TArray<TWeakObjectPtr<AMarchingCubeGen>> RecentlyEditedChunks;
+
+	// Chunk the octree was centered on when it was last updated, the predicted chunk of the player
+	FIntVector LastPlayerChunk = FIntVector::ZeroValue;
+
+	// Prediction of the player movement, see GetPrefetchChunk
+	FVector LastPawnVelocity = FVector::ZeroVector;
+	FVector PawnAcceleration = FVector::ZeroVector; // smoothed over a few frames
+	FVector PredictedLocation = FVector::ZeroVector;
+
+	FTerrainOctree Octree;
+
+	// Chunks with a save file, coarse nodes gather their modifications
+	TSet<FIntVector> SavedChunks;
+
+	// Nodes replaced by a split or merge, kept visible until the leaves covering their region have meshed
+	TArray<AMarchingCubeGen*> RetiringChunks;
+
+	// Render component shared by the nodes of a 2x2x2 block of the same level, one draw for the whole block
+	struct FRenderBatch
+	{
+		UTerrainMeshComponent* Component = nullptr; // kept alive as an instance component of the terrain
+		TWeakObjectPtr<AMarchingCubeGen> Slots[8]; // chunk drawn in each slot
+	};
+
+	// Render batches, keyed by the node of the next level containing the block
+	TMap<FTerrainNodeKey, FRenderBatch> RenderBatches;
+
+	// Generation config shared by every chunk, built in BeginPlay
+	FTerrainWorldConfigPtr WorldConfig;
+
+	// Column heights and border faces shared by the chunks
+	TSharedPtr<FTerrainSampleCache, ESPMode::ThreadSafe> SampleCache;
+
+	// Data of recently unloaded chunks
+	FRecentChunkCache RecentChunks;
+	FDelegateHandle MemoryTrimHandle;
+	void OnMemoryTrim();
+
+	// Generated nodes without any surface, entirely underground
+	TSet<FTerrainNodeKey> SolidNodes;
+
+	// Pending nodes enclosed by solid nodes, they can't be seen until one of those is dug into or unloaded
+	TSet<FTerrainNodeKey> DeferredChunks;
+
+	// Coarse nodes waiting for the save files of the chunks they cover, spawned once they are read
+	TSet<FTerrainNodeKey> GatheringNodes;
+
 	FIntVector GetPlayerChunk() const;
-	void SpawnChunkAt(const FIntVector& ChunkCoords);
+	void SpawnChunkAt(const FTerrainNodeKey& Node);
+	void CreateChunk(const FTerrainNodeKey& Node, TMap<FIntVector, float>&& Modifications);
+	void OnModificationsGathered(const FTerrainNodeKey& Node, TMap<FIntVector, float>&& Modifications);
+	FIntVector GetPrefetchChunk(float DeltaTime);
+	AMarchingCubeGen* ReclaimRetiringChunk(const FTerrainNodeKey& Node);
+	void DestroyReplacedChunks();
+	bool IsRegionMeshed(const FTerrainNodeKey& Node) const;
+	bool IsLeafMeshed(const FTerrainNodeKey& Leaf) const;
+	void SpawnPendingChunks();
+	float GetLoadPriority(const FTerrainNodeKey& Node, const FVector& ViewLocation, const FVector& ViewDirection, float HalfFov) const;
+	bool IsEnclosedBySolidNodes(const FTerrainNodeKey& Node) const;
+	void RestoreDeferredChunks();
+	FTerrainWorldConfigPtr MakeWorldConfig() const;
+	static void GatherModifications(uint32 WorldHash, int32 ChunkSize, const FTerrainNodeKey& Node, const TArray<FIntVector>& SavedChildren, TMap<FIntVector, float>& OutModifications);
+	static FTerrainNodeKey GetBatchKey(const FTerrainNodeKey& Node); //helper
+	static int32 GetBatchSlot(const FTerrainNodeKey& Node); //helper
 	void GenerateWorld();
 };
\ No newline at end of file
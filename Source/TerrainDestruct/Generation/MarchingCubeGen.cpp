@@ -1,6 +1,12 @@
 #include "MarchingCubeGen.h"
-#include "TerrainDestruct/Utils/FastNoiseLite.h"
-#include "ProceduralMeshComponent.h"
+#include "TerrainDestruct/Utils/ChunkDensity.h"
+#include "TerrainDestruct/Utils/ChunkEditStore.h"
+#include "TerrainDestruct/Utils/ChunkMeshCache.h"
+#include "TerrainDestruct/Utils/TerrainStats.h"
+#include "TerrainMeshComponent.h"
+#include "GenerateTerrain.h"
+#include "Async/Async.h"
+#include "Hash/CityHash.h"
 
 // Constructor for the Marching Cubes terrain generation actor
 AMarchingCubeGen::AMarchingCubeGen()
@@ -8,374 +14,385 @@ AMarchingCubeGen::AMarchingCubeGen()
 	// Enable tick for frame updates
 	PrimaryActorTick.bCanEverTick = true;
 	
-	// Create the procedural mesh component
-	mesh = CreateDefaultSubobject<UProceduralMeshComponent>("Mesh");
-	
-	// Initialize the Perlin noise generator
-	noise = new FastNoiseLite();
+	// Create the terrain mesh component, it only holds the chunk's collision: the terrain draws the chunk in a render batch
+	mesh = CreateDefaultSubobject<UTerrainMeshComponent>("Mesh");
+	mesh->bCollisionOnly = true;
 
-	// Disable shadow casting for performance optimization
-	mesh->SetCastShadow(false);
 
 	// Set the mesh as the root component
 	SetRootComponent(mesh);
 }
 
-// Destructor - clean up dynamically allocated noise generator
-AMarchingCubeGen::~AMarchingCubeGen()
+
+
+// Called when the actor is spawned - generates the initial mesh with the noise of the world config
+void AMarchingCubeGen::BeginPlay()
 {
-	delete noise;
+	Super::BeginPlay();
+
+	// Generate the density grid and the mesh at the level of detail picked by the terrain
+    Regenerate();
 }
 
+// Change the faces that get transition caps, regenerating the chunk once no mesh job is running
+void AMarchingCubeGen::SetTransitionFaces(uint8 NewTransitionFaces)
+{
+	if (NewTransitionFaces == transitionFaces)
+		return;
 
+	transitionFaces = NewTransitionFaces;
 
-// Called when the actor is spawned - initializes noise and generates the initial mesh
-void AMarchingCubeGen::BeginPlay()
+	// Wait for in-flight jobs so two jobs never write the mesh out of order
+	if (meshJobsInFlight > 0)
+	{
+		bRegeneratePending = true;
+		return;
+	}
+
+	Regenerate();
+}
+
+// Generate the density grid and the mesh at the current level of detail
+void AMarchingCubeGen::Regenerate()
 {
-	Super::BeginPlay();
-	
-	// Configure the noise generator with specified parameters
-    noise->SetFrequency(frequency);
-    noise->SetNoiseType(FastNoiseLite::NoiseType_Perlin);
-    noise->SetFractalType(FastNoiseLite::FractalType_FBm);
+	bRegeneratePending = false;
 
 	// Initialize the voxel grid
     Setup();
 
-	// Get the chunk's world position converted to local coordinates
-    FVector Position = GetActorLocation() / 100;
+	// Get the chunk's world position converted to local coordinates, later edits resample the noise from there
+    NoisePosition = GetActorLocation() / 100;
 
-	// Generate mesh asynchronously on thread pool to avoid blocking the game thread
-    Async(EAsyncExecution::ThreadPool, [this, Position]()
-    {
-		// Generate the height map (voxel density values) using Perlin noise
-        GenerateHeightMap(Position);
+	// Unloaded a moment ago: restore the mesh kept by the terrain, no job needed
+	AGenerateTerrain* terrain = Cast<AGenerateTerrain>(GetOwner());
+	FRecentChunkCache::FEntry recent;
+	if (terrain && terrain->TakeRecentChunk(GetCacheKey(), recent))
+	{
+		SurfaceBricks = MoveTemp(recent.SurfaceBricks);
+		EmptyBricks = MoveTemp(recent.EmptyBricks);
+		DensityRanges = MoveTemp(recent.Ranges);
+		bSurfaceBricksReady = true;
+
+		FSharedMeshData previousMesh = MoveTemp(meshData);
+		FSharedMeshData previousCaps = MoveTemp(capMeshData);
+		meshData = MoveTemp(recent.Surface);
+		capMeshData = MoveTemp(recent.Caps);
+		vertexCount = meshData->VertexCount;
+		ApplyMesh();
+
+		// Same as a job result: the replaced arrays go back to the pool once the component holds the new meshes
+		RecycleMeshData(MoveTemp(previousMesh));
+		RecycleMeshData(MoveTemp(previousCaps));
+		return;
+	}
 
-		// Calculate number of sections to divide work across multiple CPU cores
-        int sectionCount = FMath::Max(1, FPlatformMisc::NumberOfCores() / 2);
-        TArray<TFuture<FThreadMeshData>> futures;
+	// Generate the whole chunk as one task, parallelism comes from the many chunks queued at once
+    LaunchMeshJob(UE::Tasks::ETaskPriority::BackgroundNormal, [Snapshot = MakeSnapshot(), CacheFile = GetMeshCacheFileName()]()
+    {
+        FChunkMeshResult Result;
+        Result.Surface = FMeshBufferPool::Acquire();
+        Result.Caps = FMeshBufferPool::Acquire();
 
-		// Create async tasks for each section of the mesh
-        for (int s = 0; s < sectionCount; ++s)
+		// Back in a known area: load the mesh and the density summaries instead of generating them
+        if (!CacheFile.IsEmpty() && FChunkMeshCache::Load(CacheFile, Snapshot.Resolution, ChunkDensity::GetBrickCount(Snapshot), Result))
         {
-            int zStart = s * size / sectionCount;
-            int zEnd = (s + 1) * size / sectionCount;
-
-			// Queue mesh generation for this section
-            futures.Add(Async(EAsyncExecution::ThreadPool, [this, zStart, zEnd]()
-            {
-                FThreadMeshData threadData;
-                threadData.Reset();
-                GenerateMesh(zStart, zEnd, threadData);
-                return threadData;
-            }));
+            return Result;
         }
 
-		// Once all sections are generated, combine them on the game thread
-        AsyncTask(ENamedThreads::GameThread, [this, futures = MoveTemp(futures)]() mutable
-        {
-			// Clear previous mesh data
-            meshData.Clear();
-            vertexCount = 0;
-
-			// Combine all mesh sections into a single mesh
-            for (int i = 0; i < futures.Num(); ++i)
-            {
-                FThreadMeshData td = futures[i].Get();
+		// Generate the height map (voxel density values) using Perlin noise into this worker's scratch
+        TArray<float>& Density = FMeshScratch::Get().Density;
+        ChunkDensity::Generate(Snapshot, Density);
 
-				// Offset triangle indices to account for new vertex base
-                int32 baseVertex = meshData.Vertices.Num();
+		// Summarize the density ranges so the mesher can skip the blocks without surface
+        ChunkDensity::BuildRanges(Snapshot, Density, Result.Ranges);
 
-                for (int32 t = 0; t < td.Triangles.Num(); ++t)
-                {
-                    meshData.Triangles.Add(td.Triangles[t] + baseVertex);
-                }
+        FChunkMesher Mesher(Snapshot, Density);
+        Mesher.GenerateMesh(Result.Ranges, Result.Surface);
 
-				// Append vertices, normals, and colors from this section
-                meshData.Vertices.Append(td.Vertices);
-                meshData.Normals.Append(td.Normals);
-                meshData.Colors.Append(td.Colors);
-            }
+		// Close the faces bordering chunks of another level of detail
+        Mesher.GenerateTransitionCaps(Result.Caps);
 
-			// Track total vertex count
-            vertexCount = meshData.Vertices.Num();
+		// Only remember where the surface is, the density grid is rebuilt from noise if the chunk gets edited
+        ChunkDensity::BuildSurfaceBricks(Snapshot, Density, Result.SurfaceBricks, Result.EmptyBricks);
+        Result.bHasSummaries = true;
 
-			// Apply the combined mesh to the procedural mesh component
-            ApplyMesh();
-        });
+        if (!CacheFile.IsEmpty())
+        {
+            FChunkMeshCache::Save(CacheFile, Result);
+        }
+        return Result;
     });
 }
 
-// Initialize the voxel grid with the specified size
-void AMarchingCubeGen::Setup()
+// Cache key of the chunk in its current state
+FChunkMeshCache::FKey AMarchingCubeGen::GetCacheKey() const
 {
-	// Allocate memory for (size+1)^3 voxels to store density values
-	Voxels.SetNum((size + 1) * (size + 1) * (size + 1));
+	FChunkMeshCache::FKey key;
+	key.Level = lod;
+	key.Coord = GetChunkCoord();
+	key.TransitionFaces = transitionFaces;
+	key.bDebugColors = debugColors;
+	key.EditVersion = GetEditVersion();
+	return key;
 }
 
-// Generate voxel density values using Perlin noise for terrain surface
-void AMarchingCubeGen::GenerateHeightMap(const FVector position)
+// Disk cache entry of the chunk in its current state, empty when the cache is off
+FString AMarchingCubeGen::GetMeshCacheFileName() const
 {
-	// Iterate through all voxel positions in the grid
-	for (int x = 0; x <= size; ++x)
-	{
-		for (int y = 0; y <= size; ++y)
-		{
-			for (int z = 0; z <= size; ++z)
-			{
-				// Sample noise at this position and store as voxel density
-				Voxels[GetVoxelIndex(x,y,z)] = noise->GetNoise(
-					x + position.X, 
-					y + position.Y, 
-					z + position.Z
-				);	
-			}
-		}
-	}
+	if (!useMeshCache)
+		return FString();
+
+	return FChunkMeshCache::GetFileName(config->Hash, GetCacheKey());
 }
 
-// Generate mesh geometry using marching cubes algorithm for a Z-range section
-void AMarchingCubeGen::GenerateMesh(int zStart, int zEnd,FThreadMeshData& data)
+// Mesh and density summaries for the terrain's recent chunk cache, false while the chunk isn't fully generated
+bool AMarchingCubeGen::ExportRecentEntry(FChunkMeshCache::FKey& OutKey, FRecentChunkCache::FEntry& OutEntry) const
 {
-	// Set triangle winding order based on surface level sign
-	if (surfaceLevel > 0.0f)
-	{
-		TriangleOrder[0] = 0;
-		TriangleOrder[1] = 1;
-		TriangleOrder[2] = 2;
-	}
-	else
-	{
-		TriangleOrder[0] = 2;
-		TriangleOrder[1] = 1;
-		TriangleOrder[2] = 0;
-	}
+	// A job in flight or a pending regeneration would leave the mesh out of date with the key
+	if (!bSurfaceBricksReady || meshJobsInFlight > 0 || bRegeneratePending || !meshData.IsValid())
+		return false;
+
+	OutKey = GetCacheKey();
+	OutEntry.Surface = meshData;
+	OutEntry.Caps = capMeshData;
+	OutEntry.SurfaceBricks = SurfaceBricks;
+	OutEntry.EmptyBricks = EmptyBricks;
+	OutEntry.Ranges = DensityRanges;
+	return true;
+}
 
-	// Array to store the 8 corner density values of the current cube
-	float Cube[8];
+// 64-bit digest of the modifications in voxel order, 0 when there are none.
+// It keys the cached meshes of an edited chunk, so distinct edit sets must practically never collide
+uint64 AMarchingCubeGen::GetEditVersion() const
+{
+	if (modifications.Num() == 0)
+		return 0;
 
-	// Iterate through all cube cells in the voxel grid for the specified Z-range
-	for (int X = 0; X < size; ++X)
+	TArray<TPair<FIntVector, float>> edits = modifications.Array();
+	edits.Sort([](const TPair<FIntVector, float>& A, const TPair<FIntVector, float>& B)
 	{
-		for (int Y = 0; Y < size; ++Y)
-		{
-			for (int Z = zStart; Z < zEnd; ++Z)
-			{
-				// Gather the 8 corner voxel densities for this cube
-				for (int i = 0; i < 8; ++i)
-				{
-					int VX = X + VertexOffset[i][0];
-					int VY = Y + VertexOffset[i][1];
-					int VZ = Z + VertexOffset[i][2];
-
-					Cube[i] = GetVoxelDensityWithModif(VX, VY, VZ);
-				}
-
-				// Process this cube with the marching cubes algorithm
-				March(X, Y, Z, Cube, data);
-			}
-		}
+		if (A.Key.Z != B.Key.Z)
+			return A.Key.Z < B.Key.Z;
+		if (A.Key.Y != B.Key.Y)
+			return A.Key.Y < B.Key.Y;
+		return A.Key.X < B.Key.X;
+	});
+
+	// Hash the packed position and value bits of every edit
+	TArray<int32> packed;
+	packed.Reserve(edits.Num() * 4);
+	for (const TPair<FIntVector, float>& edit : edits)
+	{
+		packed.Add(edit.Key.X);
+		packed.Add(edit.Key.Y);
+		packed.Add(edit.Key.Z);
+
+		int32 valueBits;
+		FMemory::Memcpy(&valueBits, &edit.Value, sizeof(float));
+		packed.Add(valueBits);
 	}
+
+	const uint64 version = CityHash64(reinterpret_cast<const char*>(packed.GetData()), packed.Num() * sizeof(int32));
+	return version != 0 ? version : 1;
 }
 
-// Process a single cube using the marching cubes algorithm to create triangles
-void AMarchingCubeGen::March(int X, int Y, int Z, const float Cube[8],FThreadMeshData& data)
+// Run a mesh job on the task scheduler and apply its result on the game thread.
+// Jobs of the same chunk are chained so their meshes are applied in order.
+void AMarchingCubeGen::LaunchMeshJob(UE::Tasks::ETaskPriority Priority, TUniqueFunction<FChunkMeshResult()>&& Job)
 {
-	// Determine which corners are below the surface level using a bitmask
-	int VertexMask = 0;
-    FVector EdgeVertex[12];
-
-    for (int i = 0; i < 8; ++i)
+    ++meshJobsInFlight;
+    INC_DWORD_STAT(STAT_TerrainMeshJobs);
+    MeshTask = UE::Tasks::Launch(UE_SOURCE_LOCATION, [WeakThis = TWeakObjectPtr<AMarchingCubeGen>(this), Job = MoveTemp(Job)]() mutable
     {
-        if (Cube[i] <= surfaceLevel)
-        {
-        	VertexMask |= 1 << i;  
-        } 
-    }
+        FChunkMeshResult Result = Job();
+        DEC_DWORD_STAT(STAT_TerrainMeshJobs);
 
-	// Look up which edges of the cube intersect the surface
-    const int EdgeMask = CubeEdgeFlags[VertexMask];
-    if (EdgeMask == 0) return;  // No triangles for this cube
+		// Hand the result to the game thread without anyone waiting on it
+        AsyncTask(ENamedThreads::GameThread, [WeakThis, Result = MoveTemp(Result)]() mutable
+        {
+            if (AMarchingCubeGen* Chunk = WeakThis.Get())
+            {
+                Chunk->ApplyMeshResult(MoveTemp(Result));
+            }
+        });
+    }, UE::Tasks::Prerequisites(MeshTask), Priority);
+}
 
-	// Calculate intersection points along the cube edges that cross the surface
-    for (int i = 0; i < 12; ++i)
+// Move a finished job's output into the mesh data and upload it
+void AMarchingCubeGen::ApplyMeshResult(FChunkMeshResult&& Result)
+{
+	// Generation jobs only build the summaries, the chunk takes them here so edits never race with a job
+    if (Result.bHasSummaries)
     {
-        if ((EdgeMask & (1 << i)) != 0)
-        {
-			// Interpolate to find the exact surface crossing point
-            float offset = GetInterpolationOffset(Cube[EdgeConnection[i][0]], Cube[EdgeConnection[i][1]]);
-            EdgeVertex[i].X = X + VertexOffset[EdgeConnection[i][0]][0] + offset * EdgeDirection[i][0];
-            EdgeVertex[i].Y = Y + VertexOffset[EdgeConnection[i][0]][1] + offset * EdgeDirection[i][1];
-            EdgeVertex[i].Z = Z + VertexOffset[EdgeConnection[i][0]][2] + offset * EdgeDirection[i][2];
-        }
+        DensityRanges = MoveTemp(Result.Ranges);
+        SurfaceBricks = MoveTemp(Result.SurfaceBricks);
+        EmptyBricks = MoveTemp(Result.EmptyBricks);
+        bSurfaceBricksReady = true;
     }
 
-	// Generate up to 5 triangles for this cube based on surface configuration
-    for (int i = 0; i < 5; ++i)
-    {
-        if (TriangleConnectionTable[VertexMask][3*i] < 0) break;
+    FSharedMeshData previousMesh = MoveTemp(meshData);
+    FSharedMeshData previousCaps = MoveTemp(capMeshData);
 
-		// Get the three vertices of this triangle in world space (multiply by 100 for UE units)
-        auto V1 = EdgeVertex[TriangleConnectionTable[VertexMask][3*i]] * 100;
-        auto V2 = EdgeVertex[TriangleConnectionTable[VertexMask][3*i + 1]] * 100;
-        auto V3 = EdgeVertex[TriangleConnectionTable[VertexMask][3*i + 2]] * 100;
+    meshData = AdoptMeshData(MoveTemp(Result.Surface));
+    vertexCount = meshData->VertexCount;
 
-		// Calculate surface normal from cross product of triangle edges
-        auto Normal = FVector::CrossProduct(V2 - V1, V3 - V1);
-        if (!Normal.Normalize()) Normal = FVector::UpVector;
-        Normal.Normalize();
+	// Transition caps are kept apart so they don't get merged with the surface vertices
+    capMeshData = AdoptMeshData(MoveTemp(Result.Caps));
 
-		// Assign a random color to each triangle (for debugging)
-        auto Color = FColor::MakeRandomColor();
+	// Apply the mesh to the terrain mesh component
+    ApplyMesh();
+
+	// The component now holds the new meshes, the previous arrays can go back to the pool
+    RecycleMeshData(MoveTemp(previousMesh));
+    RecycleMeshData(MoveTemp(previousCaps));
+    OnMeshJobFinished();
+}
 
-		// Add the three vertices to the mesh data
-        data.Vertices.Append({V1, V2, V3});
+// Called when the chunk is unloaded
+void AMarchingCubeGen::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// Running jobs only hold their snapshot and post back through a weak pointer, the chunk doesn't wait for them
+	UpdateMemoryStats(true);
 
-		// Add triangle indices with proper winding order
-        data.Triangles.Append({ data.VertexCount + TriangleOrder[0],
-                                data.VertexCount + TriangleOrder[1],
-                                data.VertexCount + TriangleOrder[2] });
+	// Stop drawing the chunk in its render batch, and keep its data in case the player comes back
+	if (EndPlayReason == EEndPlayReason::Destroyed)
+	{
+		if (AGenerateTerrain* terrain = Cast<AGenerateTerrain>(GetOwner()))
+		{
+			terrain->RemoveChunkMesh(this);
+			terrain->KeepRecentChunk(this);
+		}
+	}
 
-		// Add normals and colors for each vertex
-        data.Normals.Append({Normal, Normal, Normal});
-        data.Colors.Append({Color, Color, Color});
-        data.VertexCount += 3;
-    }
+	Super::EndPlay(EndPlayReason);
 }
 
-// Convert 3D voxel coordinates to a 1D array index
-int AMarchingCubeGen::GetVoxelIndex(int X, int Y, int Z) const
+// Called on the game thread when a mesh job has been applied
+void AMarchingCubeGen::OnMeshJobFinished()
 {
-	return Z * (size + 1) * (size + 1) + Y * (size + 1) + X;
+	--meshJobsInFlight;
+
+	// The transition faces changed while the job was running
+	if (meshJobsInFlight == 0 && bRegeneratePending)
+	{
+		Regenerate();
+	}
 }
 
-// Calculate linear interpolation offset between two density values to find surface crossing point
-float AMarchingCubeGen::GetInterpolationOffset(float V1, float V2) const
+// Initialize the voxel grid for the current level of detail
+void AMarchingCubeGen::Setup()
 {
-	const float delta = V2 - V1;
-	// Avoid division by zero
-	if (fabsf(delta) < 1e-6f)
-		return 0.5f;
-
-	// Clamp interpolation to valid range [0, 1]
-	float t = (surfaceLevel - V1) / delta;
-	return FMath::Clamp(t, 0.0f, 1.0f);
+	// Each level of detail doubles the voxel spacing and halves the grid resolution
+	lod = FMath::Clamp(lod, 0, FMath::FloorLog2(FMath::Max(size, 1)));
+	while (lod > 0 && size % (1 << lod) != 0)
+	{
+		--lod;
+	}
+	stride = 1 << lod;
+	resolution = FMath::Max(size / stride, 1);
+
+	// Any cached density belongs to the previous resolution
+	ReleaseDensity();
+	bSurfaceBricksReady = false;
+
+	// Allocate the per-brick residency bitmaps
+	const int brickCount = GetBrickCount();
+	SurfaceBricks.Init(false, brickCount);
+	EmptyBricks.Init(false, brickCount);
+	EditedBricks.Init(false, brickCount);
+
+	// Modifications loaded from disk have to be regenerated exactly when the chunk is remeshed
+	EditBricks.Reset();
+	for (const auto& Pair : modifications)
+	{
+		EditBricks.Set(Pair.Key, Pair.Value);
+		MarkEditedBricks(Pair.Key);
+	}
 }
 
-
-// Apply generated mesh data to the procedural mesh component with vertex deduplication
+// Apply generated mesh data to the collision and to the chunk's render batch
 void AMarchingCubeGen::ApplyMesh()
 {
-	// Map to track duplicate vertices based on quantized position
-	TMap<FIntVector, int32> vertexLookup;
+	SCOPE_CYCLE_COUNTER(STAT_TerrainApplyMesh);
+	TRACE_CPUPROFILER_EVENT_SCOPE(AMarchingCubeGen::ApplyMesh);
 
-	// Precision threshold for vertex merging (prevents duplicate vertices with slight position variations)
-    const float precision = 0.001f; 
+	// Collision stays on the chunk so traces keep hitting the chunk actor
+    mesh->UpdateSection(0, meshData, true);
 
-	// Final mesh data with deduplicated vertices
-    TArray<FVector> finalVertices;
-    TArray<FVector> finalNormals;
-    TArray<FColor>  finalColors;
-    TArray<int32>   finalTriangles;
-	
-	// Quantize vertex position to a grid for duplicate detection
-    auto Quantize = [&](const FVector& v)
+	// The terrain draws the surface and the transition caps (no collision) in the batch of neighbouring chunks
+    if (AGenerateTerrain* terrain = Cast<AGenerateTerrain>(GetOwner()))
     {
-        return FIntVector(
-            FMath::RoundToInt(v.X / precision),
-            FMath::RoundToInt(v.Y / precision),
-            FMath::RoundToInt(v.Z / precision)
-        );
-    };
-
-	// Add or retrieve vertex index, merging duplicate vertices and accumulating normals
-    auto GetOrAddVertex = [&](const FVector& v, const FVector& n, const FColor& c)
-    {
-        FIntVector key = Quantize(v);
-        if (int32* existingIndex = vertexLookup.Find(key))
-        {
-			// Vertex already exists - accumulate its normal for better lighting
-            finalNormals[*existingIndex] += n;
-            return *existingIndex;
-        }
+        terrain->SetChunkMesh(this, meshData, capMeshData);
+        terrain->OnChunkMeshed(this);
+    }
 
-		// Create new vertex entry
-        int32 newIndex = finalVertices.Num();
-        vertexLookup.Add(key, newIndex);
-        finalVertices.Add(v);
-        finalNormals.Add(n);
-        finalColors.Add(c);
-        return newIndex;
-    };
-
-	// Process all triangles and deduplicate vertices
-	for (int32 i = 0; i < meshData.Triangles.Num(); i += 3)
+    UpdateMemoryStats(false);
+}
+
+// Report the chunk's voxel grid, meshes and edits to the Terrain stats group, as differences with the last report
+void AMarchingCubeGen::UpdateMemoryStats(bool bReleased)
+{
+	SIZE_T voxelBytes = 0;
+	SIZE_T meshBytes = 0;
+	int32 editEntries = 0;
+	if (!bReleased)
 	{
-		int32 i1 = GetOrAddVertex(
-			meshData.Vertices[meshData.Triangles[i]],
-			meshData.Normals[meshData.Triangles[i]],
-			meshData.Colors[meshData.Triangles[i]]
-		);
-		int32 i2 = GetOrAddVertex(
-			meshData.Vertices[meshData.Triangles[i + 1]],
-			meshData.Normals[meshData.Triangles[i + 1]],
-			meshData.Colors[meshData.Triangles[i + 1]]
-		);
-		int32 i3 = GetOrAddVertex(
-			meshData.Vertices[meshData.Triangles[i + 2]],
-			meshData.Normals[meshData.Triangles[i + 2]],
-			meshData.Colors[meshData.Triangles[i + 2]]
-		);
-
-		// Only add triangle if all three vertices are unique (skip degenerate triangles)
-		if (i1 != i2 && i2 != i3 && i3 != i1)
+		// Published by the last edit job, reading it never waits on a running one
+		if (DensityCache)
 		{
-			finalTriangles.Append({i1, i2, i3});
+			voxelBytes = DensityCache->AllocatedSize.load(std::memory_order_relaxed);
+		}
+		for (const FSharedMeshData& data : { meshData, capMeshData })
+		{
+			if (data.IsValid())
+			{
+				meshBytes += data->Positions.GetAllocatedSize() + data->Triangles.GetAllocatedSize()
+					+ data->Normals.GetAllocatedSize() + data->Colors.GetAllocatedSize();
+			}
 		}
+		editEntries = modifications.Num();
 	}
 
-	// Normalize all accumulated normals
-    for (FVector& N : finalNormals)
-    {
-        N.Normalize();
-    }
+	INC_MEMORY_STAT_BY(STAT_TerrainVoxelMemory, voxelBytes);
+	DEC_MEMORY_STAT_BY(STAT_TerrainVoxelMemory, statVoxelBytes);
+	INC_MEMORY_STAT_BY(STAT_TerrainMeshMemory, meshBytes);
+	DEC_MEMORY_STAT_BY(STAT_TerrainMeshMemory, statMeshBytes);
+	INC_DWORD_STAT_BY(STAT_TerrainEditEntries, editEntries);
+	DEC_DWORD_STAT_BY(STAT_TerrainEditEntries, statEditEntries);
 
-	// Create mesh section with final deduplicated data
-    mesh->SetMaterial(0, material);
-    mesh->CreateMeshSection(
-        0,
-        finalVertices,
-        finalTriangles,
-        finalNormals,
-        meshData.UV0,     
-        finalColors,
-        TArray<FProcMeshTangent>(),
-        true
-    );
+	statVoxelBytes = voxelBytes;
+	statMeshBytes = meshBytes;
+	statEditEntries = editEntries;
 }
 
-// Get voxel density value with modification deltas applied
-float AMarchingCubeGen::GetVoxelDensityWithModif(int X, int Y, int Z) const
+// True once generated if every grid point of the chunk is solid (above the surface level) and it has no edits
+bool AMarchingCubeGen::IsSolid() const
 {
-	// Create voxel position key
-	FIntVector Key(X, Y, Z);
-	
-	// Get base density from noise
-	float BaseDensity = Voxels[GetVoxelIndex(X, Y, Z)];
-	
-	// Add any modifications made by the player (terrain destruction/building)
-	if (const float* Delta = modifications.Find(Key))
-	{
-		BaseDensity += *Delta;
-	}
-
-	return BaseDensity;
+	// Solid when no brick crosses the surface and none is empty, so every brick lies above the surface level
+	return bSurfaceBricksReady && modifications.Num() == 0
+		&& SurfaceBricks.Find(true) == INDEX_NONE && EmptyBricks.Find(true) == INDEX_NONE;
 }
 
+// True once the chunk has been meshed, or restored from the recent chunk cache
+bool AMarchingCubeGen::HasMesh() const
+{
+	return meshData.IsValid();
+}
 
 // Modify voxels within a radius sphere for terrain destruction/creation
 void AMarchingCubeGen::ModifyVoxel(const FVector& worldPos, float editingSpeed, float brushRadius)
 {
+    SCOPE_CYCLE_COUNTER(STAT_TerrainModifyVoxel);
+    TRACE_CPUPROFILER_EVENT_SCOPE(AMarchingCubeGen::ModifyVoxel);
+
+    // Ignore edits until the generation has located the surface
+    if (!bSurfaceBricksReady || bRegeneratePending)
+        return;
+
+    // Coarse octree nodes only display the edits saved by full resolution chunks
+    if (lod > 0)
+        return;
+
     // Convert world position to local chunk coordinates
     FVector Local = (worldPos - GetActorLocation()) / 100.0f;
 
@@ -411,8 +428,13 @@ void AMarchingCubeGen::ModifyVoxel(const FVector& worldPos, float editingSpeed,
                     FIntVector voxelIndex(x, y, z);
                     float& currentDensity = modifications.FindOrAdd(voxelIndex, 0.0f);
 
-                    // Accumulate the density change
+                    // Accumulate the density change, in-flight jobs keep reading the brick version they captured
                     currentDensity += deltaDensity;
+                    EditBricks.Add(voxelIndex, deltaDensity);
+                    MarkEditedBricks(voxelIndex);
+
+                    // Keep the block ranges conservative (edits only happen at full resolution)
+                    DensityRanges.Widen(x, y, z, deltaDensity);
                 }
             }
         }
@@ -420,30 +442,77 @@ void AMarchingCubeGen::ModifyVoxel(const FVector& worldPos, float editingSpeed,
 
 	// Save modifications to disk
 	SaveModifications();
+
+	// Keep this chunk's density grid cached while it is being edited
+	if (AGenerateTerrain* terrain = Cast<AGenerateTerrain>(GetOwner()))
+	{
+		terrain->TouchEditedChunk(this);
+	}
+
+	// Bricks that need real noise values: the ones crossing the surface and the edited ones
+	TBitArray<> RequiredBricks = SurfaceBricks;
+	RequiredBricks.CombineWithBitwiseOR(EditedBricks, EBitwiseOperatorFlags::MaxSize);
     
-    // Asynchronously rebuild the mesh on a thread pool
-    TFuture<FThreadMeshData> Future = Async(EAsyncExecution::ThreadPool, [this]() -> FThreadMeshData
+    // Rebuild the mesh as a task, ahead of background chunk generation
+    LaunchMeshJob(UE::Tasks::ETaskPriority::Normal, [RequiredBricks = MoveTemp(RequiredBricks), Ranges = DensityRanges, Snapshot = MakeSnapshot()]()
     {
-        FThreadMeshData ThreadData;
-        ThreadData.Reset();
-        GenerateMesh(0, size, ThreadData);
-        return ThreadData;
+		// Rebuild the density grid into this worker's scratch for the remesh
+        TArray<float>& Density = FMeshScratch::Get().Density;
+        ChunkDensity::Acquire(Snapshot, RequiredBricks, Density);
+
+        FChunkMeshResult Result;
+        Result.Surface = FMeshBufferPool::Acquire();
+        Result.Caps = FMeshBufferPool::Acquire();
+        FChunkMesher Mesher(Snapshot, Density);
+        Mesher.GenerateMesh(Ranges, Result.Surface);
+        Mesher.GenerateTransitionCaps(Result.Caps);
+        return Result;
     });
+}
 
-    // Apply the updated mesh on the game thread
-    AsyncTask(ENamedThreads::GameThread, [this, Future = MoveTemp(Future)]() mutable
-    {
-        FThreadMeshData Result = Future.Get();
-
-        meshData.Clear();
-        meshData.Vertices = MoveTemp(Result.Vertices);
-        meshData.Triangles = MoveTemp(Result.Triangles);
-        meshData.Normals = MoveTemp(Result.Normals);
-        meshData.Colors = MoveTemp(Result.Colors);
-        meshData.VertexCount = Result.VertexCount;
-    	
-        ApplyMesh();
-    });
+// Capture everything the mesher reads, so the job never touches the actor's mutable state
+FChunkSnapshot AMarchingCubeGen::MakeSnapshot() const
+{
+	FChunkSnapshot Snapshot;
+	Snapshot.SurfaceLevel = config->SurfaceLevel;
+	Snapshot.Resolution = resolution;
+	Snapshot.Stride = stride;
+	Snapshot.TransitionFaces = transitionFaces;
+	Snapshot.bDebugColors = debugColors;
+	Snapshot.ColorSeed = (int32)GetTypeHash(GetChunkCoord());
+	Snapshot.Edits = EditBricks; // only copies brick pointers
+	Snapshot.Config = config;
+	Snapshot.SampleCache = sampleCache;
+	Snapshot.NoisePosition = NoisePosition;
+	Snapshot.EmptyBricks = EmptyBricks;
+	Snapshot.DensityCache = DensityCache;
+	return Snapshot;
+}
+
+// Wrap a job's output for the mesh component without copying its arrays
+FSharedMeshData AMarchingCubeGen::AdoptMeshData(FThreadMeshData&& Source)
+{
+	FSharedMeshData Target = MakeShared<FMeshData, ESPMode::ThreadSafe>();
+	Target->Positions = MoveTemp(Source.Positions);
+	Target->Triangles = MoveTemp(Source.Triangles);
+	Target->Normals = MoveTemp(Source.Normals);
+	Target->Colors = MoveTemp(Source.Colors);
+	Target->VertexCount = Source.VertexCount;
+	return Target;
+}
+
+// Give the arrays of a replaced mesh back to the pool, unless the render thread is still uploading them
+void AMarchingCubeGen::RecycleMeshData(FSharedMeshData&& Previous)
+{
+	if (!Previous.IsValid() || !Previous.IsUnique())
+		return;
+
+	FThreadMeshData Buffers;
+	Buffers.Positions = MoveTemp(Previous->Positions);
+	Buffers.Triangles = MoveTemp(Previous->Triangles);
+	Buffers.Normals = MoveTemp(Previous->Normals);
+	Buffers.Colors = MoveTemp(Previous->Colors);
+	FMeshBufferPool::Release(MoveTemp(Buffers));
 }
 
 // Save voxel modifications to disk for persistence between sessions
@@ -453,89 +522,83 @@ void AMarchingCubeGen::SaveModifications()
 	if (modifications.Num() == 0)
 		return;
 
-	// Create a copy of modifications for async save
-	TMap<FIntVector, float> ModCopy = modifications;
-
-	// Create save directory path
-	FString SaveDir = FPaths::ProjectSavedDir() / TEXT("VoxelChunks");
-	IFileManager::Get().MakeDirectory(*SaveDir, true);
-
-	// Calculate chunk coordinates from actor location
-	FIntVector ChunkCoord(
-		FMath::FloorToInt(GetActorLocation().X / (size * 100)),
-		FMath::FloorToInt(GetActorLocation().Y / (size * 100)),
-		FMath::FloorToInt(GetActorLocation().Z / (size * 100))
-	);
-
 	// Create unique filename based on chunk coordinates
-	FString FileName = FString::Printf(TEXT("%s/Chunk_%d_%d_%d.sav"),
-		*SaveDir, ChunkCoord.X, ChunkCoord.Y, ChunkCoord.Z);
-
-	// Save modifications asynchronously to avoid blocking the game thread
-	Async(EAsyncExecution::ThreadPool, [FileName, ModCopy = MoveTemp(ModCopy)]()
-	{
-		// Format modifications as CSV data
-		FString SaveData;
-		SaveData.Reserve(ModCopy.Num() * 32); 
-
-		// Convert each modification to a CSV line
-		for (const auto& Pair : ModCopy)
-		{
-			SaveData += FString::Printf(TEXT("%d,%d,%d,%f\n"),
-				Pair.Key.X, Pair.Key.Y, Pair.Key.Z, Pair.Value);
-		}
+	FString FileName = FChunkEditStore::GetChunkFileName(config->Hash, GetChunkCoord());
 
-		// Write data to file
-		FFileHelper::SaveStringToFile(SaveData, *FileName);
-	});
+	// Save a copy asynchronously to avoid blocking the game thread, edits made during a save are coalesced
+	FChunkEditStore::SaveAsync(FileName, modifications);
 }
 
 // Load voxel modifications from disk to restore terrain changes
 void AMarchingCubeGen::LoadModifications()
 {
-	// Get the saved chunks directory
-	FString SaveDir = FPaths::ProjectSavedDir() / TEXT("VoxelChunks");
+	SCOPE_CYCLE_COUNTER(STAT_TerrainLoadEdits);
+	TRACE_CPUPROFILER_EVENT_SCOPE(AMarchingCubeGen::LoadModifications);
+
+	// Create the filename for this chunk's save file
+	FString FileName = FChunkEditStore::GetChunkFileName(config->Hash, GetChunkCoord());
 
-	// Calculate chunk coordinates from actor location
-	FIntVector ChunkCoord(
+	// Decode the edit store straight into the modification map, nothing is loaded when there is no save file
+	FChunkEditStore::Load(FileName, modifications);
+}
+
+// Calculate chunk coordinates from actor location
+FIntVector AMarchingCubeGen::GetChunkCoord() const
+{
+	return FIntVector(
 		FMath::FloorToInt(GetActorLocation().X / (size * 100)),
 		FMath::FloorToInt(GetActorLocation().Y / (size * 100)),
 		FMath::FloorToInt(GetActorLocation().Z / (size * 100))
 	);
+}
 
-	// Create the filename for this chunk's save file
-	FString FileName = FString::Printf(TEXT("%s/Chunk_%d_%d_%d.sav"),
-		*SaveDir, ChunkCoord.X, ChunkCoord.Y, ChunkCoord.Z);
+// Number of residency bricks in the chunk (bricks of cells, BrickSize^3 cells each)
+int AMarchingCubeGen::GetBrickCount() const
+{
+	const int bricksPerAxis = FMath::DivideAndRoundUp(resolution, FVoxelBrickGrid::BrickSize);
+	return bricksPerAxis * bricksPerAxis * bricksPerAxis;
+}
 
-	// If save file doesn't exist, no modifications to load
-	if (!FPaths::FileExists(FileName))
-		return;
+// Convert brick coordinates to an index in the residency bitmaps
+int AMarchingCubeGen::GetBrickIndex(int BX, int BY, int BZ) const
+{
+	const int bricksPerAxis = FMath::DivideAndRoundUp(resolution, FVoxelBrickGrid::BrickSize);
+	return (BZ * bricksPerAxis + BY) * bricksPerAxis + BX;
+}
 
-	// Load the file contents
-	FString LoadedData;
-	FFileHelper::LoadFileToString(LoadedData, *FileName);
+// Flag the bricks whose cells read the given voxel (in full resolution voxels) as edited
+void AMarchingCubeGen::MarkEditedBricks(const FIntVector& Voxel)
+{
+	// At lower levels of detail only voxels on the coarse grid are ever read
+	if (Voxel.X % stride != 0 || Voxel.Y % stride != 0 || Voxel.Z % stride != 0)
+		return;
 
-	// Parse the data line by line
-	TArray<FString> Lines;
-	LoadedData.ParseIntoArrayLines(Lines);
+	const FIntVector gridVoxel(Voxel.X / stride, Voxel.Y / stride, Voxel.Z / stride);
 
-	// Process each modification line
-	for (FString& Line : Lines)
+	// A voxel is a corner of the cells starting at Voxel - 1 and Voxel on every axis
+	for (int dz = -1; dz <= 0; ++dz)
 	{
-		// Parse CSV format: X,Y,Z,Density
-		TArray<FString> Parts;
-		Line.ParseIntoArray(Parts, TEXT(","), true);
-		if (Parts.Num() != 4) continue;
-
-		// Extract voxel position and density value
-		FIntVector Pos(
-			FCString::Atoi(*Parts[0]),
-			FCString::Atoi(*Parts[1]),
-			FCString::Atoi(*Parts[2])
-		);
-		float Density = FCString::Atof(*Parts[3]);
-		
-		// Add modification to the map
-		modifications.Add(Pos, Density);
+		for (int dy = -1; dy <= 0; ++dy)
+		{
+			for (int dx = -1; dx <= 0; ++dx)
+			{
+				const FIntVector cell = gridVoxel + FIntVector(dx, dy, dz);
+				if (cell.X < 0 || cell.Y < 0 || cell.Z < 0 || cell.X >= resolution || cell.Y >= resolution || cell.Z >= resolution)
+					continue;
+
+				EditedBricks[GetBrickIndex(
+					cell.X / FVoxelBrickGrid::BrickSize,
+					cell.Y / FVoxelBrickGrid::BrickSize,
+					cell.Z / FVoxelBrickGrid::BrickSize)] = true;
+			}
+		}
 	}
-}
\ No newline at end of file
+}
+
+// Drop the cached density grid, the next edit rebuilds it from noise.
+// A job still running keeps the grid it was launched with until it ends
+void AMarchingCubeGen::ReleaseDensity()
+{
+	DensityCache = MakeShared<FChunkDensityCache, ESPMode::ThreadSafe>();
+	UpdateMemoryStats(false);
+}
@@ -0,0 +1,605 @@
+#include "TerrainMeshComponent.h"
+#include "TerrainDestruct/Utils/TerrainVertex.h"
+#include "TerrainDestruct/Utils/TerrainStats.h"
+#include "PrimitiveSceneProxy.h"
+#include "PrimitiveViewRelevance.h"
+#include "SceneManagement.h"
+#include "SceneInterface.h"
+#include "LocalVertexFactory.h"
+#include "MaterialShared.h"
+#include "MaterialDomain.h"
+#include "Materials/Material.h"
+#include "RenderingThread.h"
+#include "PhysicsEngine/BodySetup.h"
+#include "Engine/CollisionProfile.h"
+
+namespace
+{
+	// Smallest section allocation, in vertices or indices
+	constexpr uint32 MinSectionCapacity = 256;
+
+	// Buffers grow to the next power of two, so a section growing edit after edit is only reallocated a few times
+	uint32 GetSectionCapacity(uint32 NumElements)
+	{
+		return FMath::RoundUpToPowerOfTwo(FMath::Max(NumElements, MinSectionCapacity));
+	}
+
+	// Index ranges hold a power of two number of whole triangles, so the sections laid out back to back
+	// in the shared index buffer all start on a triangle boundary of the single draw
+	uint32 GetSectionIndexCapacity(uint32 NumIndices)
+	{
+		return 3 * GetSectionCapacity(FMath::DivideAndRoundUp(NumIndices, 3u));
+	}
+
+	// A mesh is updated in place when it fits the buffers and is not so small that most of the draw would be padding
+	bool FitsSectionCapacity(uint32 NumElements, uint32 Capacity)
+	{
+		return NumElements <= Capacity && (Capacity <= MinSectionCapacity || NumElements * 4 > Capacity);
+	}
+
+	// Persistent vertex stream of a proxy, shared by all its sections.
+	// Static buffers keep their contents across locks, so an update only writes the range it changes.
+	class FTerrainVertexStream : public FVertexBuffer
+	{
+	public:
+		FTerrainVertexStream(uint32 InStride, EPixelFormat InFormat, const TCHAR* InName)
+			: Stride(InStride), Format(InFormat), Name(InName)
+		{
+		}
+
+		// Write access to NumElements elements starting at First
+		void* Lock(FRHICommandListBase& RHICmdList, uint32 First, uint32 NumElements)
+		{
+			return RHICmdList.LockBuffer(VertexBufferRHI, First * Stride, NumElements * Stride, RLM_WriteOnly);
+		}
+
+		void Unlock(FRHICommandListBase& RHICmdList)
+		{
+			RHICmdList.UnlockBuffer(VertexBufferRHI);
+		}
+
+		virtual void InitRHI(FRHICommandListBase& RHICmdList) override
+		{
+			FRHIResourceCreateInfo CreateInfo(Name);
+			VertexBufferRHI = RHICmdList.CreateVertexBuffer(Capacity * Stride, BUF_Static | BUF_ShaderResource, CreateInfo);
+			SRV = RHICmdList.CreateShaderResourceView(VertexBufferRHI, FRHIViewDesc::CreateBufferSRV()
+				.SetType(FRHIViewDesc::EBufferType::Typed)
+				.SetFormat(Format));
+		}
+
+		virtual void ReleaseRHI() override
+		{
+			SRV.SafeRelease();
+			FVertexBuffer::ReleaseRHI();
+		}
+
+		FShaderResourceViewRHIRef SRV; // for manual vertex fetch
+		uint32 Capacity = 0;
+
+	private:
+		uint32 Stride;
+		EPixelFormat Format;
+		const TCHAR* Name;
+	};
+
+	// Persistent 32-bit index buffer of a proxy
+	class FTerrainIndexBuffer : public FIndexBuffer
+	{
+	public:
+		uint32* Lock(FRHICommandListBase& RHICmdList, uint32 First, uint32 NumIndices)
+		{
+			return (uint32*)RHICmdList.LockBuffer(IndexBufferRHI, First * sizeof(uint32), NumIndices * sizeof(uint32), RLM_WriteOnly);
+		}
+
+		void Unlock(FRHICommandListBase& RHICmdList)
+		{
+			RHICmdList.UnlockBuffer(IndexBufferRHI);
+		}
+
+		virtual void InitRHI(FRHICommandListBase& RHICmdList) override
+		{
+			FRHIResourceCreateInfo CreateInfo(TEXT("TerrainIndices"));
+			IndexBufferRHI = RHICmdList.CreateIndexBuffer(sizeof(uint32), Capacity * sizeof(uint32), BUF_Static, CreateInfo);
+		}
+
+		uint32 Capacity = 0;
+	};
+
+	// Range of the shared buffers owned by a section
+	struct FTerrainSectionRange
+	{
+		uint32 FirstVertex = 0;
+		uint32 VertexCapacity = 0;
+		uint32 FirstIndex = 0;
+		uint32 IndexCapacity = 0;
+		uint32 NumIndices = 0; // indices in use, the rest of the range is degenerate triangles
+	};
+
+	// Any unit vector orthogonal to the normal, the terrain material has no tangent space
+	FVector3f GetTangent(const FVector3f& Normal)
+	{
+		const FVector3f axis = FMath::Abs(Normal.X) < 0.9f ? FVector3f::ForwardVector : FVector3f::RightVector;
+		return (axis - Normal * FVector3f::DotProduct(axis, Normal)).GetSafeNormal();
+	}
+}
+
+// Scene proxy of a terrain mesh component.
+// All sections live in consecutive ranges of one set of buffers and are drawn by a single static mesh batch over the
+// whole capacity, the unused tail of every range holds degenerate triangles. The cached draw command therefore stays
+// valid while updates rewrite a section's range in place; only a section outgrowing its range recreates the proxy.
+class FTerrainMeshSceneProxy final : public FPrimitiveSceneProxy
+{
+public:
+	FTerrainMeshSceneProxy(UTerrainMeshComponent* Component)
+		: FPrimitiveSceneProxy(Component)
+		, Positions(sizeof(FVector3f), PF_R32_FLOAT, TEXT("TerrainPositions"))
+		, Tangents(2 * sizeof(FPackedNormal), PF_R8G8B8A8_SNORM, TEXT("TerrainTangents"))
+		, Colors(sizeof(FColor), PF_R8G8B8A8, TEXT("TerrainColors"))
+		, TexCoords(sizeof(FVector2DHalf), PF_G16R16F, TEXT("TerrainTexCoords"))
+		, VertexFactory(GetScene().GetFeatureLevel(), "FTerrainMeshSceneProxy")
+		, MaterialRelevance(Component->GetMaterialRelevance(GetScene().GetShaderPlatform()))
+	{
+		UMaterialInterface* material = Component->GetMaterial(0);
+		if (!material)
+		{
+			material = UMaterial::GetDefaultMaterial(MD_Surface);
+		}
+		Material = material->GetRenderProxy();
+
+		// Lay the sections out one after the other, with the capacities picked by the component
+		uint32 numVertices = 0;
+		uint32 numIndices = 0;
+		for (const UTerrainMeshComponent::FSection& componentSection : Component->Sections)
+		{
+			FTerrainSectionRange& range = Ranges.AddDefaulted_GetRef();
+			range.FirstVertex = numVertices;
+			range.VertexCapacity = componentSection.VertexCapacity;
+			range.FirstIndex = numIndices;
+			range.IndexCapacity = componentSection.IndexCapacity;
+			numVertices += componentSection.VertexCapacity;
+			numIndices += componentSection.IndexCapacity;
+			bHasColors |= componentSection.bHasColors;
+
+			// Uploaded when the render thread creates the proxy's resources
+			InitialData.Add({ componentSection.Data, componentSection.Offset });
+		}
+
+		Positions.Capacity = numVertices;
+		Tangents.Capacity = numVertices;
+		TexCoords.Capacity = numVertices;
+		Colors.Capacity = bHasColors ? numVertices : 0;
+		Indices.Capacity = numIndices;
+	}
+
+	virtual ~FTerrainMeshSceneProxy() override
+	{
+		VertexFactory.ReleaseResource();
+		Positions.ReleaseResource();
+		Tangents.ReleaseResource();
+		Colors.ReleaseResource();
+		TexCoords.ReleaseResource();
+		Indices.ReleaseResource();
+	}
+
+	virtual void CreateRenderThreadResources(FRHICommandListBase& RHICmdList) override
+	{
+		if (Indices.Capacity == 0)
+			return;
+
+		Positions.InitResource(RHICmdList);
+		Tangents.InitResource(RHICmdList);
+		TexCoords.InitResource(RHICmdList);
+		if (bHasColors)
+		{
+			Colors.InitResource(RHICmdList);
+		}
+		Indices.InitResource(RHICmdList);
+
+		// The terrain has no UVs, and every index starts out degenerate
+		FMemory::Memzero(TexCoords.Lock(RHICmdList, 0, TexCoords.Capacity), TexCoords.Capacity * sizeof(FVector2DHalf));
+		TexCoords.Unlock(RHICmdList);
+		FMemory::Memzero(Indices.Lock(RHICmdList, 0, Indices.Capacity), Indices.Capacity * sizeof(uint32));
+		Indices.Unlock(RHICmdList);
+
+		for (int32 i = 0; i < Ranges.Num(); ++i)
+		{
+			UploadSection(RHICmdList, i, InitialData[i].Key.Get(), InitialData[i].Value);
+		}
+		InitialData.Empty();
+
+		BindVertexFactory(RHICmdList);
+	}
+
+	int32 GetNumSections() const { return Ranges.Num(); }
+
+	// Write a section's new mesh over the old one in its range. Only the used part of the range is written,
+	// plus degenerate triangles over the indices the previous mesh used beyond the new one.
+	void UploadSection(FRHICommandListBase& RHICmdList, int32 SectionIndex, const FMeshData* Data, const FVector3f& Offset)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_TerrainUploadSection);
+		TRACE_CPUPROFILER_EVENT_SCOPE(FTerrainMeshSceneProxy::UploadSection);
+
+		FTerrainSectionRange& range = Ranges[SectionIndex];
+		const uint32 numVertices = Data ? Data->VertexCount : 0;
+		const uint32 numIndices = Data ? Data->Triangles.Num() : 0;
+		check(numVertices <= range.VertexCapacity && numIndices <= range.IndexCapacity);
+
+		if (numVertices > 0)
+		{
+			// Chunk positions are moved into the space of the component
+			FVector3f* positions = (FVector3f*)Positions.Lock(RHICmdList, range.FirstVertex, numVertices);
+			for (uint32 v = 0; v < numVertices; ++v)
+			{
+				positions[v] = Data->Positions[v] + Offset;
+			}
+			Positions.Unlock(RHICmdList);
+
+			FPackedNormal* tangents = (FPackedNormal*)Tangents.Lock(RHICmdList, range.FirstVertex, numVertices);
+			for (uint32 v = 0; v < numVertices; ++v)
+			{
+				const FVector3f normal = TerrainVertex::UnpackNormal(Data->Normals[v]);
+				tangents[2 * v] = FPackedNormal(GetTangent(normal));
+				tangents[2 * v + 1] = FPackedNormal(FVector4f(normal, 1.0f));
+			}
+			Tangents.Unlock(RHICmdList);
+
+			// Sections without debug colors sharing buffers with colored ones are drawn white
+			if (bHasColors)
+			{
+				FColor* colors = (FColor*)Colors.Lock(RHICmdList, range.FirstVertex, numVertices);
+				if (Data->Colors.Num() == (int32)numVertices)
+				{
+					FMemory::Memcpy(colors, Data->Colors.GetData(), numVertices * sizeof(FColor));
+				}
+				else
+				{
+					for (uint32 v = 0; v < numVertices; ++v)
+					{
+						colors[v] = FColor::White;
+					}
+				}
+				Colors.Unlock(RHICmdList);
+			}
+		}
+
+		// New triangles, then collapse the triangles the previous mesh had beyond them
+		const uint32 writtenIndices = FMath::Max(numIndices, range.NumIndices);
+		if (writtenIndices > 0)
+		{
+			uint32* indices = Indices.Lock(RHICmdList, range.FirstIndex, writtenIndices);
+			for (uint32 i = 0; i < numIndices; ++i)
+			{
+				indices[i] = Data->Triangles[i] + range.FirstVertex;
+			}
+			FMemory::Memzero(indices + numIndices, (writtenIndices - numIndices) * sizeof(uint32));
+			Indices.Unlock(RHICmdList);
+		}
+
+		range.NumIndices = numIndices;
+	}
+
+	virtual void DrawStaticElements(FStaticPrimitiveDrawInterface* PDI) override
+	{
+		if (Indices.Capacity == 0)
+			return;
+
+		FMeshBatch mesh;
+		mesh.VertexFactory = &VertexFactory;
+		mesh.MaterialRenderProxy = Material;
+		mesh.ReverseCulling = IsLocalToWorldDeterminantNegative();
+		mesh.Type = PT_TriangleList;
+		mesh.DepthPriorityGroup = SDPG_World;
+		mesh.LODIndex = 0;
+
+		// One draw for every section, the padding triangles have no area
+		FMeshBatchElement& element = mesh.Elements[0];
+		element.IndexBuffer = &Indices;
+		element.FirstIndex = 0;
+		element.NumPrimitives = Indices.Capacity / 3;
+		element.MinVertexIndex = 0;
+		element.MaxVertexIndex = Positions.Capacity - 1;
+		PDI->DrawMesh(mesh, FLT_MAX);
+	}
+
+	virtual FPrimitiveViewRelevance GetViewRelevance(const FSceneView* View) const override
+	{
+		FPrimitiveViewRelevance Result;
+		Result.bDrawRelevance = IsShown(View);
+		Result.bShadowRelevance = IsShadowCast(View);
+		Result.bStaticRelevance = true;
+		Result.bRenderInMainPass = ShouldRenderInMainPass();
+		Result.bUsesLightingChannels = GetLightingChannelMask() != GetDefaultLightingChannelMask();
+		Result.bRenderCustomDepth = ShouldRenderCustomDepth();
+		MaterialRelevance.SetPrimitiveViewRelevance(Result);
+		Result.bVelocityRelevance = DrawsVelocity() && Result.bOpaque && Result.bRenderInMainPass;
+		return Result;
+	}
+
+	virtual bool CanBeOccluded() const override
+	{
+		return !MaterialRelevance.bDisableDepthTest;
+	}
+
+	virtual uint32 GetMemoryFootprint() const override
+	{
+		return sizeof(*this) + GetAllocatedSize();
+	}
+
+	virtual SIZE_T GetTypeHash() const override
+	{
+		static size_t UniquePointer;
+		return reinterpret_cast<size_t>(&UniquePointer);
+	}
+
+private:
+	// Point the vertex factory at the shared streams
+	void BindVertexFactory(FRHICommandListBase& RHICmdList)
+	{
+		FLocalVertexFactory::FDataType data;
+		data.PositionComponent = FVertexStreamComponent(&Positions, 0, sizeof(FVector3f), VET_Float3);
+		data.PositionComponentSRV = Positions.SRV;
+		data.TangentBasisComponents[0] = FVertexStreamComponent(&Tangents, 0, 2 * sizeof(FPackedNormal), VET_PackedNormal);
+		data.TangentBasisComponents[1] = FVertexStreamComponent(&Tangents, sizeof(FPackedNormal), 2 * sizeof(FPackedNormal), VET_PackedNormal);
+		data.TangentsSRV = Tangents.SRV;
+		data.TextureCoordinates.Add(FVertexStreamComponent(&TexCoords, 0, sizeof(FVector2DHalf), VET_Half2));
+		data.TextureCoordinatesSRV = TexCoords.SRV;
+		data.NumTexCoords = 1;
+
+		// Without debug colors every vertex reads the same white color
+		if (bHasColors)
+		{
+			data.ColorComponent = FVertexStreamComponent(&Colors, 0, sizeof(FColor), VET_Color);
+			data.ColorComponentsSRV = Colors.SRV;
+			data.ColorIndexMask = ~0u;
+		}
+		else
+		{
+			data.ColorComponent = FVertexStreamComponent(&GNullColorVertexBuffer, 0, 0, VET_Color, EVertexStreamUsage::ManualFetch);
+			data.ColorComponentsSRV = GNullColorVertexBuffer.VertexBufferSRV;
+			data.ColorIndexMask = 0;
+		}
+
+		VertexFactory.SetData(RHICmdList, data);
+		VertexFactory.InitResource(RHICmdList);
+	}
+
+	FTerrainVertexStream Positions;
+	FTerrainVertexStream Tangents; // tangent X then Z, rebuilt from the packed normals
+	FTerrainVertexStream Colors; // only allocated when a section has debug colors
+	FTerrainVertexStream TexCoords; // zeros written at allocation
+	FTerrainIndexBuffer Indices;
+	FLocalVertexFactory VertexFactory;
+	FMaterialRenderProxy* Material = nullptr;
+	bool bHasColors = false;
+
+	TArray<FTerrainSectionRange> Ranges;
+	TArray<TPair<FSharedMeshData, FVector3f>> InitialData; // mesh and offset of every section, released once uploaded
+	FMaterialRelevance MaterialRelevance;
+};
+
+// Constructor of the terrain mesh component
+UTerrainMeshComponent::UTerrainMeshComponent()
+{
+	// The player's traces and the pawn collide with the terrain surface
+	SetCollisionProfileName(UCollisionProfile::BlockAllDynamic_ProfileName);
+}
+
+// Replace the mesh of a section, in place when it fits the section's range of the buffers
+void UTerrainMeshComponent::UpdateSection(int32 SectionIndex, const FSharedMeshData& Data, bool bEnableCollision, const FVector3f& Offset)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TerrainUpdateSection);
+	TRACE_CPUPROFILER_EVENT_SCOPE(UTerrainMeshComponent::UpdateSection);
+
+	if (!Sections.IsValidIndex(SectionIndex))
+	{
+		Sections.SetNum(SectionIndex + 1);
+	}
+
+	FSection& section = Sections[SectionIndex];
+	const bool bCollisionChanged = bEnableCollision || section.bEnableCollision;
+	section.Data = Data;
+	section.bEnableCollision = bEnableCollision;
+	section.Offset = Offset;
+	section.Bounds = Data.IsValid() && Data->Positions.Num() > 0 ? FBox3f(Data->Positions).ShiftBy(Offset) : FBox3f(ForceInit);
+
+	// Collision only components have no render state to update
+	if (bCollisionOnly)
+	{
+		UpdateBounds();
+		if (bCollisionChanged)
+		{
+			UpdateCollision();
+		}
+		return;
+	}
+
+	const uint32 numVertices = Data.IsValid() ? Data->VertexCount : 0;
+	const uint32 numIndices = Data.IsValid() ? Data->Triangles.Num() : 0;
+	const bool bHasColors = numVertices > 0 && Data->Colors.Num() == (int32)numVertices;
+
+	// Edits that keep roughly the same topology size only rewrite the buffers
+	if (FitsSectionCapacity(numVertices, section.VertexCapacity) && FitsSectionCapacity(FMath::DivideAndRoundUp(numIndices, 3u), section.IndexCapacity / 3)
+		&& (bHasColors == section.bHasColors || numVertices == 0))
+	{
+		SendSectionToProxy(SectionIndex);
+	}
+	else
+	{
+		// Large topology change: double the range (or shrink it) and build a new proxy around the new layout
+		section.VertexCapacity = GetSectionCapacity(numVertices);
+		section.IndexCapacity = GetSectionIndexCapacity(numIndices);
+		section.bHasColors = bHasColors;
+		MarkRenderStateDirty();
+	}
+
+	// New bounds have to reach the scene
+	UpdateBounds();
+	MarkRenderTransformDirty();
+
+	if (bCollisionChanged)
+	{
+		UpdateCollision();
+	}
+}
+
+// Remove the mesh of a section, its buffers are kept for the next update
+void UTerrainMeshComponent::ClearSection(int32 SectionIndex)
+{
+	if (!Sections.IsValidIndex(SectionIndex) || !Sections[SectionIndex].Data.IsValid())
+		return;
+
+	UpdateSection(SectionIndex, FSharedMeshData(), false);
+}
+
+// Hand a section's mesh to the render thread, or build a new proxy if the current one doesn't have the section
+void UTerrainMeshComponent::SendSectionToProxy(int32 SectionIndex)
+{
+	// A proxy about to be recreated would upload into buffers of the old size, the new one reads the latest mesh
+	if (IsRenderStateDirty())
+		return;
+
+	FTerrainMeshSceneProxy* proxy = (FTerrainMeshSceneProxy*)SceneProxy;
+	if (!proxy || SectionIndex >= proxy->GetNumSections())
+	{
+		MarkRenderStateDirty();
+		return;
+	}
+
+	ENQUEUE_RENDER_COMMAND(TerrainMeshUpdateSection)([proxy, SectionIndex, Data = Sections[SectionIndex].Data, Offset = Sections[SectionIndex].Offset](FRHICommandListImmediate& RHICmdList)
+	{
+		proxy->UploadSection(RHICmdList, SectionIndex, Data.Get(), Offset);
+	});
+}
+
+FPrimitiveSceneProxy* UTerrainMeshComponent::CreateSceneProxy()
+{
+	return !bCollisionOnly && Sections.Num() > 0 ? new FTerrainMeshSceneProxy(this) : nullptr;
+}
+
+// Every section is drawn with the same material, in one draw
+int32 UTerrainMeshComponent::GetNumMaterials() const
+{
+	return 1;
+}
+
+// Bounds of every section in world space
+FBoxSphereBounds UTerrainMeshComponent::CalcBounds(const FTransform& LocalToWorld) const
+{
+	FBox3f localBox(ForceInit);
+	for (const FSection& section : Sections)
+	{
+		localBox += section.Bounds;
+	}
+
+	if (!localBox.IsValid)
+		return FBoxSphereBounds(LocalToWorld.GetLocation(), FVector::ZeroVector, 0.0);
+
+	return FBoxSphereBounds(FBox(localBox)).TransformBy(LocalToWorld);
+}
+
+UBodySetup* UTerrainMeshComponent::GetBodySetup()
+{
+	if (!BodySetup)
+	{
+		BodySetup = CreateBodySetup();
+	}
+	return BodySetup;
+}
+
+// Gather the triangles of the sections with collision, positions are already in the float format physics wants
+bool UTerrainMeshComponent::GetPhysicsTriMeshData(FTriMeshCollisionData* CollisionData, bool InUseAllTriData)
+{
+	int32 vertexBase = 0;
+	for (int32 sectionIndex = 0; sectionIndex < Sections.Num(); ++sectionIndex)
+	{
+		const FSection& section = Sections[sectionIndex];
+		if (!section.bEnableCollision || !section.Data.IsValid())
+			continue;
+
+		const FMeshData& data = *section.Data;
+		for (const FVector3f& position : data.Positions)
+		{
+			CollisionData->Vertices.Add(position + section.Offset);
+		}
+
+		for (int32 t = 0; t + 2 < data.Triangles.Num(); t += 3)
+		{
+			FTriIndices triangle;
+			triangle.v0 = data.Triangles[t] + vertexBase;
+			triangle.v1 = data.Triangles[t + 1] + vertexBase;
+			triangle.v2 = data.Triangles[t + 2] + vertexBase;
+			CollisionData->Indices.Add(triangle);
+			CollisionData->MaterialIndices.Add(sectionIndex);
+		}
+
+		vertexBase += data.Positions.Num();
+	}
+
+	CollisionData->bFlipNormals = true;
+	CollisionData->bDeformableMesh = true;
+	CollisionData->bFastCook = true;
+	return true;
+}
+
+bool UTerrainMeshComponent::ContainsPhysicsTriMeshData(bool InUseAllTriData) const
+{
+	for (const FSection& section : Sections)
+	{
+		if (section.bEnableCollision && section.Data.IsValid() && section.Data->Triangles.Num() >= 3)
+			return true;
+	}
+	return false;
+}
+
+// Cook the collision again, off the game thread in game worlds
+void UTerrainMeshComponent::UpdateCollision()
+{
+	SCOPE_CYCLE_COUNTER(STAT_TerrainUpdateCollision);
+	TRACE_CPUPROFILER_EVENT_SCOPE(UTerrainMeshComponent::UpdateCollision);
+
+	UWorld* world = GetWorld();
+	if (world && world->IsGameWorld())
+	{
+		UBodySetup* newBodySetup = CreateBodySetup();
+		AsyncBodySetupQueue.Add(newBodySetup);
+		newBodySetup->CreatePhysicsMeshesAsync(FOnAsyncPhysicsCookFinished::CreateUObject(this, &UTerrainMeshComponent::FinishPhysicsAsyncCook, newBodySetup));
+	}
+	else
+	{
+		GetBodySetup()->InvalidatePhysicsData();
+		BodySetup->CreatePhysicsMeshes();
+		RecreatePhysicsState();
+	}
+}
+
+// Use a finished cook unless a newer one already replaced it
+void UTerrainMeshComponent::FinishPhysicsAsyncCook(bool bSuccess, UBodySetup* FinishedBodySetup)
+{
+	int32 foundIndex;
+	if (!AsyncBodySetupQueue.Find(FinishedBodySetup, foundIndex))
+		return;
+
+	if (bSuccess)
+	{
+		BodySetup = FinishedBodySetup;
+		RecreatePhysicsState();
+
+		// Older cooks are out of date
+		AsyncBodySetupQueue.RemoveAt(0, foundIndex + 1);
+	}
+	else
+	{
+		AsyncBodySetupQueue.RemoveAt(foundIndex);
+	}
+}
+
+// Body setup using the triangles of the mesh as simple collision
+UBodySetup* UTerrainMeshComponent::CreateBodySetup()
+{
+	UBodySetup* newBodySetup = NewObject<UBodySetup>(this, NAME_None, IsTemplate() ? RF_Public | RF_ArchetypeObject : RF_NoFlags);
+	newBodySetup->BodySetupGuid = FGuid::NewGuid();
+	newBodySetup->bGenerateMirroredCollision = false;
+	newBodySetup->bDoubleSidedGeometry = true;
+	newBodySetup->CollisionTraceFlag = CTF_UseComplexAsSimple;
+	return newBodySetup;
+}
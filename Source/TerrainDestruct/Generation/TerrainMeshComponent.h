@@ -0,0 +1,72 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/MeshComponent.h"
+#include "Interfaces/Interface_CollisionDataProvider.h"
+#include "TerrainDestruct/Utils/MeshData.h"
+#include "TerrainMeshComponent.generated.h"
+
+class UBodySetup;
+
+// Lightweight mesh component of the terrain.
+// Its sections share one set of persistent GPU buffers and one draw, each owning a range with a power of two capacity.
+// An update that fits its range hands the mesh to the render thread, which rewrites the used part in place;
+// only large topology changes recreate the scene proxy.
+UCLASS()
+class TERRAINDESTRUCT_API UTerrainMeshComponent : public UMeshComponent, public IInterface_CollisionDataProvider
+{
+	GENERATED_BODY()
+
+public:
+	UTerrainMeshComponent();
+
+	// Only cook collision, the mesh is drawn by another component. Set before the component is registered
+	bool bCollisionOnly = false;
+
+	// Replace the mesh of a section, Offset moves it into the component's space.
+	// Data is read by the render thread and the collision cook, it must not change afterwards
+	void UpdateSection(int32 SectionIndex, const FSharedMeshData& Data, bool bEnableCollision, const FVector3f& Offset = FVector3f::ZeroVector);
+	void ClearSection(int32 SectionIndex);
+
+	// UPrimitiveComponent interface
+	virtual FPrimitiveSceneProxy* CreateSceneProxy() override;
+	virtual UBodySetup* GetBodySetup() override;
+	virtual int32 GetNumMaterials() const override;
+	virtual FBoxSphereBounds CalcBounds(const FTransform& LocalToWorld) const override;
+
+	// IInterface_CollisionDataProvider interface
+	virtual bool GetPhysicsTriMeshData(struct FTriMeshCollisionData* CollisionData, bool InUseAllTriData) override;
+	virtual bool ContainsPhysicsTriMeshData(bool InUseAllTriData) const override;
+	virtual bool WantsNegXTriMesh() override { return false; }
+
+private:
+	friend class FTerrainMeshSceneProxy;
+
+	struct FSection
+	{
+		FSharedMeshData Data;
+		FBox3f Bounds = FBox3f(ForceInit);
+		FVector3f Offset = FVector3f::ZeroVector;
+		bool bEnableCollision = false;
+
+		// Size of the section's range of the GPU buffers, laid out when the proxy is created
+		uint32 VertexCapacity = 0;
+		uint32 IndexCapacity = 0;
+		bool bHasColors = false;
+	};
+
+	TArray<FSection> Sections;
+
+	// Collision of the sections with collision enabled, cooked asynchronously in game worlds
+	UPROPERTY(Instanced)
+	TObjectPtr<UBodySetup> BodySetup;
+
+	// Cooks in flight, oldest first
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UBodySetup>> AsyncBodySetupQueue;
+
+	void SendSectionToProxy(int32 SectionIndex);
+	void UpdateCollision();
+	void FinishPhysicsAsyncCook(bool bSuccess, UBodySetup* FinishedBodySetup);
+	UBodySetup* CreateBodySetup(); //helper
+};
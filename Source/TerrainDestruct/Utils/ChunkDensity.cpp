@@ -0,0 +1,401 @@
+#include "ChunkDensity.h"
+#include "TerrainStats.h"
+#include "TerrainSampleCache.h"
+
+namespace
+{
+	// Convert 3D grid coordinates to a 1D array index
+	int32 GetVoxelIndex(const FChunkSnapshot& Snapshot, int32 X, int32 Y, int32 Z)
+	{
+		return (Z * (Snapshot.Resolution + 1) + Y) * (Snapshot.Resolution + 1) + X;
+	}
+
+	int32 GetBricksPerAxis(const FChunkSnapshot& Snapshot)
+	{
+		return FMath::DivideAndRoundUp(Snapshot.Resolution, FVoxelBrickGrid::BrickSize);
+	}
+
+	// Convert brick coordinates to an index in the residency bitmaps
+	int32 GetBrickIndex(const FChunkSnapshot& Snapshot, int32 BX, int32 BY, int32 BZ)
+	{
+		const int32 bricksPerAxis = GetBricksPerAxis(Snapshot);
+		return (BZ * bricksPerAxis + BY) * bricksPerAxis + BX;
+	}
+
+	// Grid points read by the cells of a brick along one axis (the cells plus their far corner layer)
+	void GetBrickVoxelRange(const FChunkSnapshot& Snapshot, int32 BrickCoord, int32& OutStart, int32& OutEnd)
+	{
+		OutStart = BrickCoord * FVoxelBrickGrid::BrickSize;
+		OutEnd = FMath::Min(OutStart + FVoxelBrickGrid::BrickSize, Snapshot.Resolution);
+	}
+
+	// 2D heights of the column of the chunk, in HeightAmplitude units, shared by every chunk stacked along Z
+	FTerrainSampleCache::FColumnRef GetColumnHeights(const FChunkSnapshot& Snapshot)
+	{
+		const FTerrainWorldConfig& config = *Snapshot.Config;
+		const FVector& position = Snapshot.NoisePosition;
+		auto generate = [&Snapshot, &config, &position](TArray<float>& Heights)
+		{
+			const int32 resolution = Snapshot.Resolution;
+			Heights.SetNumUninitialized((resolution + 1) * (resolution + 1));
+			for (int32 y = 0; y <= resolution; ++y)
+			{
+				for (int32 x = 0; x <= resolution; ++x)
+				{
+					Heights[y * (resolution + 1) + x] = config.Noise.GetNoise(x * Snapshot.Stride + position.X, y * Snapshot.Stride + position.Y);
+				}
+			}
+		};
+
+		if (!Snapshot.SampleCache)
+		{
+			TSharedRef<TArray<float>, ESPMode::ThreadSafe> heights = MakeShared<TArray<float>, ESPMode::ThreadSafe>();
+			generate(*heights);
+			return heights;
+		}
+		return Snapshot.SampleCache->GetColumn(FIntVector(FMath::RoundToInt(position.X), FMath::RoundToInt(position.Y), Snapshot.Stride), generate);
+	}
+
+	// Key of the face of the grid at index Layer along Axis, the same for the chunk on the other side
+	FTerrainSampleCache::FFaceKey GetFaceKey(const FChunkSnapshot& Snapshot, int32 Axis, int32 Layer)
+	{
+		const FVector& position = Snapshot.NoisePosition;
+		FTerrainSampleCache::FFaceKey key;
+		key.Origin = FIntVector(FMath::RoundToInt(position.X), FMath::RoundToInt(position.Y), FMath::RoundToInt(position.Z));
+		key.Origin[Axis] += Layer * Snapshot.Stride;
+		key.Axis = Axis;
+		key.Stride = Snapshot.Stride;
+		return key;
+	}
+
+	// Copy the grid layer at index Layer along Axis to Face, or Face back into the grid
+	void CopyFaceLayer(const FChunkSnapshot& Snapshot, TArray<float>& Density, int32 Axis, int32 Layer, TArray<float>& Face, bool bToDensity)
+	{
+		const int32 resolution = Snapshot.Resolution;
+		const int32 uAxis = (Axis + 1) % 3;
+		const int32 vAxis = (Axis + 2) % 3;
+		if (!bToDensity)
+		{
+			Face.SetNumUninitialized((resolution + 1) * (resolution + 1));
+		}
+
+		FIntVector voxel;
+		voxel[Axis] = Layer;
+		for (int32 v = 0; v <= resolution; ++v)
+		{
+			voxel[vAxis] = v;
+			for (int32 u = 0; u <= resolution; ++u)
+			{
+				voxel[uAxis] = u;
+				float& sample = Density[GetVoxelIndex(Snapshot, voxel.X, voxel.Y, voxel.Z)];
+				float& shared = Face[v * (resolution + 1) + u];
+				if (bToDensity)
+					sample = shared;
+				else
+					shared = sample;
+			}
+		}
+	}
+}
+
+// Number of residency bricks of a chunk
+int32 ChunkDensity::GetBrickCount(const FChunkSnapshot& Snapshot)
+{
+	const int32 bricksPerAxis = GetBricksPerAxis(Snapshot);
+	return bricksPerAxis * bricksPerAxis * bricksPerAxis;
+}
+
+// Sample the whole grid, copying the border faces a neighbour of the same level already sampled
+void ChunkDensity::Generate(const FChunkSnapshot& Snapshot, TArray<float>& Density)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TerrainGenerateDensity);
+	TRACE_CPUPROFILER_EVENT_SCOPE(ChunkDensity::Generate);
+
+	const int32 resolution = Snapshot.Resolution;
+
+	// Allocate memory for (resolution+1)^3 voxels to store density values
+	Density.SetNumUninitialized((resolution + 1) * (resolution + 1) * (resolution + 1), EAllowShrinking::No);
+
+	// Border faces already sampled by a neighbour of the same level are copied instead of sampled again
+	FIntVector Min(0);
+	FIntVector Max(resolution);
+	bool sharedFaces[6] = {};
+	TArray<float> face;
+	if (Snapshot.SampleCache)
+	{
+		for (int32 f = 0; f < 6; ++f)
+		{
+			const int32 axis = f / 2;
+			const int32 layer = (f & 1) ? resolution : 0;
+			if (Snapshot.SampleCache->TakeFace(GetFaceKey(Snapshot, axis, layer), face))
+			{
+				CopyFaceLayer(Snapshot, Density, axis, layer, face, true);
+				sharedFaces[f] = true;
+				if (f & 1)
+					--Max[axis];
+				else
+					++Min[axis];
+			}
+		}
+	}
+
+	GenerateRegion(Snapshot, Density, Min, Max);
+
+	// Publish the faces sampled here for the neighbours generated later
+	if (Snapshot.SampleCache)
+	{
+		for (int32 f = 0; f < 6; ++f)
+		{
+			if (sharedFaces[f])
+				continue;
+
+			const int32 axis = f / 2;
+			const int32 layer = (f & 1) ? resolution : 0;
+			TArray<float> samples;
+			CopyFaceLayer(Snapshot, Density, axis, layer, samples, false);
+			Snapshot.SampleCache->AddFace(GetFaceKey(Snapshot, axis, layer), MoveTemp(samples));
+		}
+	}
+}
+
+// Sample the noise for every grid point between Min and Max (inclusive).
+// With a heightfield density config the density is the height of the column minus the altitude plus a small 3D detail term,
+// the 2D heights come from the column cache so the chunks stacked along Z only sample them once.
+void ChunkDensity::GenerateRegion(const FChunkSnapshot& Snapshot, TArray<float>& Density, const FIntVector& Min, const FIntVector& Max)
+{
+	const FTerrainWorldConfig& config = *Snapshot.Config;
+	const FVector& position = Snapshot.NoisePosition;
+	const int32 stride = Snapshot.Stride;
+
+	TSharedPtr<const TArray<float>, ESPMode::ThreadSafe> heights;
+	if (config.bHeightfieldDensity)
+	{
+		heights = GetColumnHeights(Snapshot);
+	}
+
+	// Iterate through all voxel positions in the region
+	for (int32 x = Min.X; x <= Max.X; ++x)
+	{
+		for (int32 y = Min.Y; y <= Max.Y; ++y)
+		{
+			if (heights)
+			{
+				const float height = (*heights)[y * (Snapshot.Resolution + 1) + x];
+				for (int32 z = Min.Z; z <= Max.Z; ++z)
+				{
+					const float altitude = z * stride + position.Z;
+					Density[GetVoxelIndex(Snapshot, x, y, z)] = height - altitude / config.HeightAmplitude + config.DetailAmplitude * config.DetailNoise.GetNoise(
+						x * stride + position.X,
+						y * stride + position.Y,
+						altitude
+					);
+				}
+				continue;
+			}
+
+			for (int32 z = Min.Z; z <= Max.Z; ++z)
+			{
+				// Sample noise at this position (grid points are stride voxels apart) and store as voxel density
+				Density[GetVoxelIndex(Snapshot, x, y, z)] = config.Noise.GetNoise(
+					x * stride + position.X,
+					y * stride + position.Y,
+					z * stride + position.Z
+				);
+			}
+		}
+	}
+}
+
+// Produce a dense density grid for remeshing, regenerating noise only for the required bricks
+void ChunkDensity::Acquire(const FChunkSnapshot& Snapshot, const TBitArray<>& RequiredBricks, TArray<float>& Density)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TerrainAcquireDensity);
+	TRACE_CPUPROFILER_EVENT_SCOPE(ChunkDensity::Acquire);
+
+	check(Snapshot.DensityCache.IsValid());
+	FChunkDensityCache& cache = *Snapshot.DensityCache;
+
+	const int32 resolution = Snapshot.Resolution;
+	const int32 bricksPerAxis = GetBricksPerAxis(Snapshot);
+	TBitArray<> bricksToGenerate(false, RequiredBricks.Num());
+
+	if (!cache.Voxels.IsEmpty())
+	{
+		// Recently edited chunk: start from the cached grid and only fill in bricks it does not hold yet
+		cache.Voxels.Decompress(Density);
+		for (int32 i = 0; i < RequiredBricks.Num(); ++i)
+		{
+			bricksToGenerate[i] = RequiredBricks[i] && !cache.ResidentBricks[i];
+		}
+
+		// The cached grid is quantized, but the neighbours mesh their shared faces from exact noise:
+		// resample the chunk border layers of the cached bricks so both sides place the same vertices
+		for (int32 BZ = 0; BZ < bricksPerAxis; ++BZ)
+		{
+			for (int32 BY = 0; BY < bricksPerAxis; ++BY)
+			{
+				for (int32 BX = 0; BX < bricksPerAxis; ++BX)
+				{
+					const int32 brickIndex = GetBrickIndex(Snapshot, BX, BY, BZ);
+					if (!RequiredBricks[brickIndex] || bricksToGenerate[brickIndex])
+						continue;
+
+					const FIntVector brickCoord(BX, BY, BZ);
+					FIntVector brickMin, brickMax;
+					for (int32 axis = 0; axis < 3; ++axis)
+					{
+						GetBrickVoxelRange(Snapshot, brickCoord[axis], brickMin[axis], brickMax[axis]);
+					}
+
+					for (int32 axis = 0; axis < 3; ++axis)
+					{
+						// Low face of the chunk
+						if (brickMin[axis] == 0)
+						{
+							FIntVector layerMax = brickMax;
+							layerMax[axis] = 0;
+							GenerateRegion(Snapshot, Density, brickMin, layerMax);
+						}
+
+						// High face of the chunk
+						if (brickMax[axis] == resolution)
+						{
+							FIntVector layerMin = brickMin;
+							layerMin[axis] = resolution;
+							GenerateRegion(Snapshot, Density, layerMin, brickMax);
+						}
+					}
+				}
+			}
+		}
+	}
+	else
+	{
+		// Bricks that don't cross the surface only need a value on the right side of it
+		Density.SetNumUninitialized((resolution + 1) * (resolution + 1) * (resolution + 1), EAllowShrinking::No);
+		cache.ResidentBricks.Init(false, RequiredBricks.Num());
+
+		for (int32 BZ = 0; BZ < bricksPerAxis; ++BZ)
+		{
+			for (int32 BY = 0; BY < bricksPerAxis; ++BY)
+			{
+				for (int32 BX = 0; BX < bricksPerAxis; ++BX)
+				{
+					const int32 brickIndex = GetBrickIndex(Snapshot, BX, BY, BZ);
+					if (RequiredBricks[brickIndex])
+						continue;
+
+					int32 x0, x1, y0, y1, z0, z1;
+					GetBrickVoxelRange(Snapshot, BX, x0, x1);
+					GetBrickVoxelRange(Snapshot, BY, y0, y1);
+					GetBrickVoxelRange(Snapshot, BZ, z0, z1);
+
+					const float fillValue = Snapshot.EmptyBricks[brickIndex] ? Snapshot.SurfaceLevel - 1.0f : Snapshot.SurfaceLevel + 1.0f;
+					for (int32 z = z0; z <= z1; ++z)
+					{
+						for (int32 y = y0; y <= y1; ++y)
+						{
+							for (int32 x = x0; x <= x1; ++x)
+							{
+								Density[GetVoxelIndex(Snapshot, x, y, z)] = fillValue;
+							}
+						}
+					}
+				}
+			}
+		}
+
+		bricksToGenerate = RequiredBricks;
+	}
+
+	// Sample the noise for the bricks (and their far corner layer) that need exact values.
+	// This runs after the fill so shared corner layers always end up with real noise.
+	for (int32 BZ = 0; BZ < bricksPerAxis; ++BZ)
+	{
+		for (int32 BY = 0; BY < bricksPerAxis; ++BY)
+		{
+			for (int32 BX = 0; BX < bricksPerAxis; ++BX)
+			{
+				const int32 brickIndex = GetBrickIndex(Snapshot, BX, BY, BZ);
+				if (!bricksToGenerate[brickIndex])
+					continue;
+
+				int32 x0, x1, y0, y1, z0, z1;
+				GetBrickVoxelRange(Snapshot, BX, x0, x1);
+				GetBrickVoxelRange(Snapshot, BY, y0, y1);
+				GetBrickVoxelRange(Snapshot, BZ, z0, z1);
+				GenerateRegion(Snapshot, Density, FIntVector(x0, y0, z0), FIntVector(x1, y1, z1));
+				cache.ResidentBricks[brickIndex] = true;
+			}
+		}
+	}
+
+	// Cache the grid compressed until the terrain evicts the chunk from its edited chunk cache
+	cache.Voxels.Compress(Density, resolution + 1);
+	cache.AllocatedSize.store(cache.Voxels.GetAllocatedSize(), std::memory_order_relaxed);
+}
+
+// Build the block density ranges of the generated grid, including the loaded modifications
+void ChunkDensity::BuildRanges(const FChunkSnapshot& Snapshot, const TArray<float>& Density, FDensityPyramid& OutRanges)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TerrainDensitySummaries);
+	TRACE_CPUPROFILER_EVENT_SCOPE(ChunkDensity::BuildRanges);
+
+	OutRanges.Build(Density, Snapshot.Resolution);
+
+	const int32 stride = Snapshot.Stride;
+	Snapshot.Edits.ForEach([stride, &OutRanges](const FIntVector& Voxel, float Delta)
+	{
+		// At lower levels of detail only voxels on the coarse grid are ever read
+		if (Voxel.X % stride != 0 || Voxel.Y % stride != 0 || Voxel.Z % stride != 0)
+			return;
+
+		OutRanges.Widen(Voxel.X / stride, Voxel.Y / stride, Voxel.Z / stride, Delta);
+	});
+}
+
+// Flag the bricks whose cells cross the surface, and which of the other bricks are empty
+void ChunkDensity::BuildSurfaceBricks(const FChunkSnapshot& Snapshot, const TArray<float>& Density, TBitArray<>& OutSurfaceBricks, TBitArray<>& OutEmptyBricks)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TerrainDensitySummaries);
+	TRACE_CPUPROFILER_EVENT_SCOPE(ChunkDensity::BuildSurfaceBricks);
+
+	const int32 bricksPerAxis = GetBricksPerAxis(Snapshot);
+	OutSurfaceBricks.Init(false, GetBrickCount(Snapshot));
+	OutEmptyBricks.Init(false, GetBrickCount(Snapshot));
+
+	for (int32 BZ = 0; BZ < bricksPerAxis; ++BZ)
+	{
+		for (int32 BY = 0; BY < bricksPerAxis; ++BY)
+		{
+			for (int32 BX = 0; BX < bricksPerAxis; ++BX)
+			{
+				int32 x0, x1, y0, y1, z0, z1;
+				GetBrickVoxelRange(Snapshot, BX, x0, x1);
+				GetBrickVoxelRange(Snapshot, BY, y0, y1);
+				GetBrickVoxelRange(Snapshot, BZ, z0, z1);
+
+				// Range of every corner used by the cells of this brick
+				float minDensity = MAX_flt;
+				float maxDensity = -MAX_flt;
+				for (int32 z = z0; z <= z1; ++z)
+				{
+					for (int32 y = y0; y <= y1; ++y)
+					{
+						for (int32 x = x0; x <= x1; ++x)
+						{
+							const float value = Density[GetVoxelIndex(Snapshot, x, y, z)];
+							minDensity = FMath::Min(minDensity, value);
+							maxDensity = FMath::Max(maxDensity, value);
+						}
+					}
+				}
+
+				// Same inside test as the mesher: a cell produces triangles only if it has corners on both sides
+				const int32 brickIndex = GetBrickIndex(Snapshot, BX, BY, BZ);
+				OutSurfaceBricks[brickIndex] = minDensity <= Snapshot.SurfaceLevel && maxDensity > Snapshot.SurfaceLevel;
+				OutEmptyBricks[brickIndex] = maxDensity <= Snapshot.SurfaceLevel;
+			}
+		}
+	}
+}
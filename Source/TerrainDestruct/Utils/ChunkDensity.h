@@ -0,0 +1,41 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ChunkMesher.h"
+#include "VoxelBrickGrid.h"
+#include <atomic>
+
+// Compressed density grid of a recently edited chunk, owned apart from the chunk actor. The chunk replaces it
+// when the grid is released, a job still running keeps the one it was launched with alive.
+// Jobs of a chunk are chained, so only one of them uses it at a time and it needs no lock.
+struct FChunkDensityCache
+{
+	FVoxelBrickGrid Voxels;
+	TBitArray<> ResidentBricks; // bricks holding real noise values in Voxels
+	std::atomic<SIZE_T> AllocatedSize{ 0 }; // memory of Voxels, published by the job for the game thread's stats
+};
+
+// Density grids of the mesh jobs, built from the noise described by an immutable chunk snapshot.
+// Grids are laid out as Z * (Resolution + 1)^2 + Y * (Resolution + 1) + X, and split into residency
+// bricks of FVoxelBrickGrid::BrickSize^3 cells.
+namespace ChunkDensity
+{
+	// Number of residency bricks of a chunk
+	int32 GetBrickCount(const FChunkSnapshot& Snapshot);
+
+	// Sample the whole grid, copying the border faces a neighbour of the same level already sampled
+	void Generate(const FChunkSnapshot& Snapshot, TArray<float>& Density);
+
+	// Sample the noise for every grid point between Min and Max (inclusive)
+	void GenerateRegion(const FChunkSnapshot& Snapshot, TArray<float>& Density, const FIntVector& Min, const FIntVector& Max);
+
+	// Produce a grid for remeshing an edited chunk: start from the snapshot's density cache and only sample
+	// the required bricks it does not hold, the other bricks are filled on the side of the surface they lie on
+	void Acquire(const FChunkSnapshot& Snapshot, const TBitArray<>& RequiredBricks, TArray<float>& Density);
+
+	// Block density ranges of a grid, widened by the snapshot's edits
+	void BuildRanges(const FChunkSnapshot& Snapshot, const TArray<float>& Density, FDensityPyramid& OutRanges);
+
+	// Flag the bricks whose cells cross the surface, and which of the other bricks are empty
+	void BuildSurfaceBricks(const FChunkSnapshot& Snapshot, const TArray<float>& Density, TBitArray<>& OutSurfaceBricks, TBitArray<>& OutEmptyBricks);
+}
@@ -0,0 +1,648 @@
+#include "ChunkEditStore.h"
+#include "TerrainStats.h"
+#include "HAL/PlatformFileManager.h"
+#include "HAL/PlatformProcess.h"
+#include "Async/Async.h"
+#include "Async/MappedFileHandle.h"
+#include "Misc/Compression.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+namespace
+{
+	// "VXED" tag written at the start of every binary edit store
+	constexpr uint32 EditStoreMagic = 0x44455856;
+	constexpr uint16 EditStoreVersionRaw = 1;
+	constexpr uint16 EditStoreVersion = 2;
+
+	// Largest error allowed when quantizing a density delta to 8 or 16 bits
+	constexpr float MaxQuantizationError = 1.0f / 4096.0f;
+
+	// How the payload following the header is encoded
+	enum class EEditStoreCodec : uint8
+	{
+		Raw,			// Fixed size FEditStoreRecord array
+		Packed,			// Run-length encoded positions with delta coded quantized values
+		PackedZlib,		// Packed stream compressed with zlib
+		PackedOodle		// Packed stream compressed with Oodle
+	};
+
+	// Header of the first binary version, only records follow it
+	struct FEditStoreHeaderV1
+	{
+		uint32 Magic;
+		uint16 Version;
+		uint16 Flags;
+		uint32 RecordCount;
+	};
+
+	// Current header, describes the codec and how to reconstruct positions and values
+	struct FEditStoreHeader
+	{
+		uint32 Magic;
+		uint16 Version;
+		EEditStoreCodec Codec;
+		uint8 QuantizationBits;		// 8, 16 or 32 (raw float values)
+		uint32 RecordCount;
+		uint32 PayloadSize;			// Bytes stored after the header
+		uint32 PackedSize;			// Bytes of the packed stream once decompressed
+		float QuantizationScale;	// Density delta represented by one quantization step
+		int32 BoundsMin[3];			// Smallest modified voxel position
+		int32 BoundsSize[3];		// Extent of the modified region, positions are linear indices inside it
+	};
+
+	// One voxel modification as stored by the raw codec
+	struct FEditStoreRecord
+	{
+		int32 X;
+		int32 Y;
+		int32 Z;
+		float Delta;
+	};
+
+	static_assert(sizeof(FEditStoreHeaderV1) == 12, "Edit store header layout changed");
+	static_assert(sizeof(FEditStoreHeader) == 48, "Edit store header layout changed");
+	static_assert(sizeof(FEditStoreRecord) == 16, "Edit store record layout changed");
+
+	// Attempts at moving a written file in place, the destination may briefly be mapped by a load
+	constexpr int32 MaxMoveAttempts = 5;
+
+	// A file with a save in flight: the modifications last passed for it, and whether the worker has yet to write them
+	struct FSaveInFlight
+	{
+		TMap<FIntVector, float> Latest;
+		bool bDirty = false;
+	};
+
+	FCriticalSection SavesLock;
+	TMap<FString, FSaveInFlight> SavesInFlight;
+
+	// Append an unsigned LEB128 varint
+	void WriteVarUInt(TArray<uint8>& Out, uint64 Value)
+	{
+		do
+		{
+			uint8 Byte = Value & 0x7F;
+			Value >>= 7;
+			if (Value != 0)
+			{
+				Byte |= 0x80;
+			}
+			Out.Add(Byte);
+		}
+		while (Value != 0);
+	}
+
+	// Read an unsigned LEB128 varint, fails instead of reading past End
+	bool ReadVarUInt(const uint8*& Cursor, const uint8* End, uint64& OutValue)
+	{
+		OutValue = 0;
+		for (int32 Shift = 0; Shift < 64; Shift += 7)
+		{
+			if (Cursor >= End)
+				return false;
+
+			const uint8 Byte = *Cursor++;
+			OutValue |= uint64(Byte & 0x7F) << Shift;
+			if ((Byte & 0x80) == 0)
+				return true;
+		}
+		return false;
+	}
+
+	// Map signed differences to unsigned so small negative steps stay small varints
+	uint64 ZigZagEncode(int64 Value)
+	{
+		return (uint64(Value) << 1) ^ uint64(Value >> 63);
+	}
+
+	int64 ZigZagDecode(uint64 Value)
+	{
+		return int64(Value >> 1) ^ -int64(Value & 1);
+	}
+
+	FName GetCompressionFormat(EEditStoreCodec Codec)
+	{
+		return Codec == EEditStoreCodec::PackedOodle ? NAME_Oodle : NAME_Zlib;
+	}
+
+	// Compress the packed stream, returns false when the format is unavailable or does not help
+	bool CompressPacked(EEditStoreCodec Codec, const TArray<uint8>& Packed, TArray<uint8>& OutCompressed)
+	{
+		const FName Format = GetCompressionFormat(Codec);
+		int32 CompressedSize = FCompression::CompressMemoryBound(Format, Packed.Num());
+		OutCompressed.SetNumUninitialized(CompressedSize);
+
+		if (!FCompression::CompressMemory(Format, OutCompressed.GetData(), CompressedSize, Packed.GetData(), Packed.Num()))
+			return false;
+
+		OutCompressed.SetNum(CompressedSize, EAllowShrinking::No);
+		return CompressedSize < Packed.Num();
+	}
+}
+
+// Save directory of a world
+FString FChunkEditStore::GetSaveDir(uint32 WorldHash)
+{
+	return GetLegacySaveDir() / FString::Printf(TEXT("%08x"), WorldHash);
+}
+
+// Directory of the saves written before they were keyed by the world config, the parent of the world directories
+FString FChunkEditStore::GetLegacySaveDir()
+{
+	return FPaths::ProjectSavedDir() / TEXT("VoxelChunks");
+}
+
+// Build the save file path of the chunk at the given chunk coordinates.
+// Edits are density deltas over the generated noise, they only make sense for the world they were made in
+FString FChunkEditStore::GetChunkFileName(uint32 WorldHash, const FIntVector& ChunkCoord)
+{
+	FString SaveDir = GetSaveDir(WorldHash);
+	return FString::Printf(TEXT("%s/Chunk_%d_%d_%d.sav"),
+		*SaveDir, ChunkCoord.X, ChunkCoord.Y, ChunkCoord.Z);
+}
+
+// Move the legacy save files into the directory of a world, they keep their text or v1 binary format
+// and are decoded as such when loaded, then rewritten in the current format on the next edit
+void FChunkEditStore::MigrateLegacySaves(uint32 WorldHash)
+{
+	const FString LegacyDir = GetLegacySaveDir();
+	const FString SaveDir = GetSaveDir(WorldHash);
+
+	TArray<FString> Files;
+	IFileManager::Get().FindFiles(Files, *(LegacyDir / TEXT("Chunk_*.sav")), true, false);
+	if (Files.Num() == 0)
+		return;
+
+	IFileManager::Get().MakeDirectory(*SaveDir, true);
+
+	int32 Migrated = 0;
+	for (const FString& File : Files)
+	{
+		// A save made in this world since the change is newer than the legacy one
+		if (FPaths::FileExists(SaveDir / File))
+			continue;
+
+		if (IFileManager::Get().Move(*(SaveDir / File), *(LegacyDir / File), false, false, false, true))
+		{
+			++Migrated;
+		}
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("Moved %d legacy chunk saves to %s"), Migrated, *SaveDir);
+}
+
+// List the chunks of a world that have a save file
+void FChunkEditStore::FindSavedChunks(uint32 WorldHash, TSet<FIntVector>& OutChunkCoords)
+{
+	const FString SaveDir = GetSaveDir(WorldHash);
+
+	TArray<FString> Files;
+	IFileManager::Get().FindFiles(Files, *(SaveDir / TEXT("Chunk_*.sav")), true, false);
+
+	for (const FString& File : Files)
+	{
+		// Chunk_X_Y_Z.sav
+		TArray<FString> Parts;
+		FPaths::GetBaseFilename(File).ParseIntoArray(Parts, TEXT("_"));
+		if (Parts.Num() != 4)
+			continue;
+
+		OutChunkCoords.Add(FIntVector(FCString::Atoi(*Parts[1]), FCString::Atoi(*Parts[2]), FCString::Atoi(*Parts[3])));
+	}
+}
+
+// Write the modifications on a worker thread, one save per file at a time
+void FChunkEditStore::SaveAsync(const FString& FileName, TMap<FIntVector, float> Modifications)
+{
+	{
+		FScopeLock Lock(&SavesLock);
+
+		// A save is already running: leave the latest modifications for it to write next
+		if (FSaveInFlight* InFlight = SavesInFlight.Find(FileName))
+		{
+			InFlight->Latest = MoveTemp(Modifications);
+			InFlight->bDirty = true;
+			return;
+		}
+
+		SavesInFlight.Add(FileName).Latest = Modifications;
+	}
+
+	Async(EAsyncExecution::ThreadPool, [FileName, Modifications = MoveTemp(Modifications)]() mutable
+	{
+		while (true)
+		{
+			{
+				SCOPE_CYCLE_COUNTER(STAT_TerrainSaveEdits);
+				TRACE_CPUPROFILER_EVENT_SCOPE(FChunkEditStore::SaveAsync);
+
+				if (!Save(FileName, Modifications))
+				{
+					UE_LOG(LogTemp, Warning, TEXT("Failed to save the chunk modifications to %s"), *FileName);
+				}
+			}
+
+			// Write again if the chunk was edited while saving, otherwise the file is up to date
+			FScopeLock Lock(&SavesLock);
+			FSaveInFlight& InFlight = SavesInFlight.FindChecked(FileName);
+			if (!InFlight.bDirty)
+			{
+				SavesInFlight.Remove(FileName);
+				return;
+			}
+			Modifications = InFlight.Latest;
+			InFlight.bDirty = false;
+		}
+	});
+}
+
+// Encode the modifications with every codec, keep the smallest one and write it to disk
+bool FChunkEditStore::Save(const FString& FileName, const TMap<FIntVector, float>& Modifications)
+{
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(FileName), true);
+
+	FEditStoreHeader Header;
+	FMemory::Memzero(Header);
+	Header.Magic = EditStoreMagic;
+	Header.Version = EditStoreVersion;
+	Header.RecordCount = Modifications.Num();
+
+	// Compute the bounds of the modified region and the largest delta
+	FIntVector BoundsMin(MAX_int32);
+	FIntVector BoundsMax(MIN_int32);
+	float MaxAbsDelta = 0.0f;
+	for (const auto& Pair : Modifications)
+	{
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			BoundsMin[Axis] = FMath::Min(BoundsMin[Axis], Pair.Key[Axis]);
+			BoundsMax[Axis] = FMath::Max(BoundsMax[Axis], Pair.Key[Axis]);
+		}
+		MaxAbsDelta = FMath::Max(MaxAbsDelta, FMath::Abs(Pair.Value));
+	}
+	const FIntVector BoundsSize = Modifications.Num() > 0 ? BoundsMax - BoundsMin + FIntVector(1) : FIntVector(0);
+
+	for (int32 Axis = 0; Axis < 3; ++Axis)
+	{
+		Header.BoundsMin[Axis] = BoundsMin[Axis];
+		Header.BoundsSize[Axis] = BoundsSize[Axis];
+	}
+
+	// Use the narrowest quantization that stays under the allowed error (half a step)
+	if (MaxAbsDelta <= 127.0f * 2.0f * MaxQuantizationError)
+	{
+		Header.QuantizationBits = 8;
+		Header.QuantizationScale = FMath::Max(MaxAbsDelta / 127.0f, UE_SMALL_NUMBER);
+	}
+	else if (MaxAbsDelta <= 32767.0f * 2.0f * MaxQuantizationError)
+	{
+		Header.QuantizationBits = 16;
+		Header.QuantizationScale = MaxAbsDelta / 32767.0f;
+	}
+	else
+	{
+		Header.QuantizationBits = 32;
+		Header.QuantizationScale = 1.0f;
+	}
+
+	// Sort the modifications by linear index inside the bounds so neighbours end up next to each other
+	TArray<TPair<uint64, float>> Sorted;
+	Sorted.Reserve(Modifications.Num());
+	for (const auto& Pair : Modifications)
+	{
+		const FIntVector Local = Pair.Key - BoundsMin;
+		const uint64 LinearIndex = (uint64(Local.Z) * BoundsSize.Y + Local.Y) * BoundsSize.X + Local.X;
+		Sorted.Emplace(LinearIndex, Pair.Value);
+	}
+	Sorted.Sort([](const TPair<uint64, float>& A, const TPair<uint64, float>& B) { return A.Key < B.Key; });
+
+	// Packed stream: runs of consecutive indices (gap, count) followed by their delta coded values
+	TArray<uint8> Packed;
+	Packed.Reserve(Sorted.Num() * 2 + 16);
+	uint64 NextIndex = 0;
+	int64 PreviousValue = 0;
+	for (int32 RunStart = 0; RunStart < Sorted.Num(); )
+	{
+		int32 RunEnd = RunStart + 1;
+		while (RunEnd < Sorted.Num() && Sorted[RunEnd].Key == Sorted[RunEnd - 1].Key + 1)
+		{
+			++RunEnd;
+		}
+
+		WriteVarUInt(Packed, Sorted[RunStart].Key - NextIndex);
+		WriteVarUInt(Packed, RunEnd - RunStart);
+
+		for (int32 i = RunStart; i < RunEnd; ++i)
+		{
+			if (Header.QuantizationBits == 32)
+			{
+				Packed.Append(reinterpret_cast<const uint8*>(&Sorted[i].Value), sizeof(float));
+			}
+			else
+			{
+				const int64 Quantized = FMath::RoundToInt(Sorted[i].Value / Header.QuantizationScale);
+				WriteVarUInt(Packed, ZigZagEncode(Quantized - PreviousValue));
+				PreviousValue = Quantized;
+			}
+		}
+
+		NextIndex = Sorted[RunEnd - 1].Key + 1;
+		RunStart = RunEnd;
+	}
+	Header.PackedSize = Packed.Num();
+
+	// Raw records are the fallback when nothing beats them
+	const int64 RawSize = int64(Modifications.Num()) * sizeof(FEditStoreRecord);
+	Header.Codec = EEditStoreCodec::Raw;
+	const TArray<uint8>* Payload = nullptr;
+	int64 BestSize = RawSize;
+
+	if (Packed.Num() < BestSize)
+	{
+		Header.Codec = EEditStoreCodec::Packed;
+		Payload = &Packed;
+		BestSize = Packed.Num();
+	}
+
+	// Try the general purpose compressors on top of the packed stream and keep whichever measures smallest
+	TArray<uint8> Compressed[2];
+	const EEditStoreCodec CompressedCodecs[2] = { EEditStoreCodec::PackedZlib, EEditStoreCodec::PackedOodle };
+	for (int32 c = 0; c < 2; ++c)
+	{
+		if (CompressPacked(CompressedCodecs[c], Packed, Compressed[c]) && Compressed[c].Num() < BestSize)
+		{
+			Header.Codec = CompressedCodecs[c];
+			Payload = &Compressed[c];
+			BestSize = Compressed[c].Num();
+		}
+	}
+
+	Header.PayloadSize = BestSize;
+
+	TArray<uint8> Buffer;
+	Buffer.Reserve(sizeof(FEditStoreHeader) + BestSize);
+	Buffer.Append(reinterpret_cast<const uint8*>(&Header), sizeof(Header));
+
+	if (Header.Codec == EEditStoreCodec::Raw)
+	{
+		for (const auto& Pair : Modifications)
+		{
+			const FEditStoreRecord Record = { Pair.Key.X, Pair.Key.Y, Pair.Key.Z, Pair.Value };
+			Buffer.Append(reinterpret_cast<const uint8*>(&Record), sizeof(Record));
+		}
+	}
+	else
+	{
+		Buffer.Append(*Payload);
+	}
+
+	// Write to a uniquely named temporary file and swap it in, so a reader never sees a partial write
+	const FString TempFileName = FPaths::CreateTempFilename(*FPaths::GetPath(FileName), TEXT("Chunk"), TEXT(".tmp"));
+	if (!FFileHelper::SaveArrayToFile(Buffer, *TempFileName))
+	{
+		IFileManager::Get().Delete(*TempFileName, false, false, true);
+		return false;
+	}
+
+	// Replacing a file fails on some platforms while a load has it mapped, the mapping only lasts for the decode
+	for (int32 Attempt = 0; Attempt < MaxMoveAttempts; ++Attempt)
+	{
+		if (IFileManager::Get().Move(*FileName, *TempFileName, true, true, false, true))
+			return true;
+
+		FPlatformProcess::Sleep(0.01f * (Attempt + 1));
+	}
+
+	IFileManager::Get().Delete(*TempFileName, false, false, true);
+	return false;
+}
+
+// Read the modifications of a chunk, memory-mapping the file when the platform allows it
+bool FChunkEditStore::Load(const FString& FileName, TMap<FIntVector, float>& OutModifications)
+{
+	// The file may not hold the latest modifications yet (or not exist at all) while they are being saved
+	{
+		FScopeLock Lock(&SavesLock);
+		if (const FSaveInFlight* InFlight = SavesInFlight.Find(FileName))
+		{
+			OutModifications.Append(InFlight->Latest);
+			return true;
+		}
+	}
+
+	if (!FPaths::FileExists(FileName))
+		return false;
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+
+	// Map the file and decode the records directly from the mapped pages
+	FOpenMappedResult MappedResult = PlatformFile.OpenMappedEx(*FileName);
+	if (MappedResult.HasValue())
+	{
+		TUniquePtr<IMappedFileHandle> MappedFile = MappedResult.StealValue();
+		const int64 FileSize = MappedFile->GetFileSize();
+		if (FileSize <= 0)
+			return false;
+
+		// The region has to be released before the file handle
+		TUniquePtr<IMappedFileRegion> Region(MappedFile->MapRegion(0, FileSize));
+		if (Region)
+		{
+			return Decode(Region->GetMappedPtr(), Region->GetMappedSize(), OutModifications);
+		}
+	}
+
+	// Fall back to a plain read when mapping is not supported (pak files, wrapped platform files...)
+	TArray<uint8> FileData;
+	if (!FFileHelper::LoadFileToArray(FileData, *FileName, FILEREAD_Silent))
+		return false;
+
+	return Decode(FileData.GetData(), FileData.Num(), OutModifications);
+}
+
+// Decode a binary edit store straight from memory into the modification map
+bool FChunkEditStore::Decode(const uint8* Data, int64 DataSize, TMap<FIntVector, float>& OutModifications)
+{
+	if (DataSize < (int64)sizeof(FEditStoreHeaderV1))
+		return DecodeLegacyText(Data, DataSize, OutModifications);
+
+	FEditStoreHeaderV1 HeaderV1;
+	FMemory::Memcpy(&HeaderV1, Data, sizeof(HeaderV1));
+
+	// Files without the magic tag were written by the old text serializer
+	if (HeaderV1.Magic != EditStoreMagic)
+		return DecodeLegacyText(Data, DataSize, OutModifications);
+
+	// First binary version: raw records right after the short header
+	if (HeaderV1.Version == EditStoreVersionRaw)
+		return DecodeRaw(Data + sizeof(FEditStoreHeaderV1), DataSize - sizeof(FEditStoreHeaderV1), HeaderV1.RecordCount, OutModifications);
+
+	if (HeaderV1.Version != EditStoreVersion || DataSize < (int64)sizeof(FEditStoreHeader))
+		return false;
+
+	FEditStoreHeader Header;
+	FMemory::Memcpy(&Header, Data, sizeof(Header));
+
+	// Refuse truncated files instead of reading past the end of the mapping
+	const uint8* Payload = Data + sizeof(FEditStoreHeader);
+	if (DataSize - (int64)sizeof(FEditStoreHeader) < Header.PayloadSize)
+		return false;
+
+	FPackedInfo Info;
+	Info.RecordCount = Header.RecordCount;
+	Info.QuantizationBits = Header.QuantizationBits;
+	Info.QuantizationScale = Header.QuantizationScale;
+	Info.BoundsMin = FIntVector(Header.BoundsMin[0], Header.BoundsMin[1], Header.BoundsMin[2]);
+	Info.BoundsSize = FIntVector(Header.BoundsSize[0], Header.BoundsSize[1], Header.BoundsSize[2]);
+
+	switch (Header.Codec)
+	{
+	case EEditStoreCodec::Raw:
+		return DecodeRaw(Payload, Header.PayloadSize, Header.RecordCount, OutModifications);
+
+	case EEditStoreCodec::Packed:
+		return DecodePacked(Payload, Header.PayloadSize, Info, OutModifications);
+
+	case EEditStoreCodec::PackedZlib:
+	case EEditStoreCodec::PackedOodle:
+	{
+		// Only the binary packed stream is inflated, values are still decoded while walking it
+		TArray<uint8> Packed;
+		Packed.SetNumUninitialized(Header.PackedSize);
+		if (!FCompression::UncompressMemory(GetCompressionFormat(Header.Codec), Packed.GetData(), Packed.Num(), Payload, Header.PayloadSize))
+			return false;
+
+		return DecodePacked(Packed.GetData(), Packed.Num(), Info, OutModifications);
+	}
+
+	default:
+		return false;
+	}
+}
+
+// Decode fixed size records
+bool FChunkEditStore::DecodeRaw(const uint8* Data, int64 DataSize, uint32 RecordCount, TMap<FIntVector, float>& OutModifications)
+{
+	if (DataSize < (int64)RecordCount * (int64)sizeof(FEditStoreRecord))
+		return false;
+
+	OutModifications.Reserve(OutModifications.Num() + RecordCount);
+
+	const uint8* Cursor = Data;
+	for (uint32 i = 0; i < RecordCount; ++i)
+	{
+		FEditStoreRecord Record;
+		FMemory::Memcpy(&Record, Cursor, sizeof(Record));
+		Cursor += sizeof(Record);
+
+		OutModifications.Add(FIntVector(Record.X, Record.Y, Record.Z), Record.Delta);
+	}
+
+	return true;
+}
+
+// Walk the packed run stream and add every modification as soon as it is decoded
+bool FChunkEditStore::DecodePacked(const uint8* Data, int64 DataSize, const FPackedInfo& Info, TMap<FIntVector, float>& OutModifications)
+{
+	const uint8* Cursor = Data;
+	const uint8* End = Data + DataSize;
+
+	OutModifications.Reserve(OutModifications.Num() + Info.RecordCount);
+
+	const uint64 SizeX = FMath::Max(Info.BoundsSize.X, 1);
+	const uint64 SizeY = FMath::Max(Info.BoundsSize.Y, 1);
+
+	uint64 NextIndex = 0;
+	int64 PreviousValue = 0;
+	uint32 Decoded = 0;
+	while (Decoded < Info.RecordCount)
+	{
+		uint64 Gap, Count;
+		if (!ReadVarUInt(Cursor, End, Gap) || !ReadVarUInt(Cursor, End, Count) || Count == 0 || Decoded + Count > Info.RecordCount)
+			return false;
+
+		uint64 LinearIndex = NextIndex + Gap;
+		for (uint64 i = 0; i < Count; ++i, ++LinearIndex)
+		{
+			float Delta;
+			if (Info.QuantizationBits == 32)
+			{
+				if (End - Cursor < (int64)sizeof(float))
+					return false;
+
+				FMemory::Memcpy(&Delta, Cursor, sizeof(float));
+				Cursor += sizeof(float);
+			}
+			else
+			{
+				uint64 Encoded;
+				if (!ReadVarUInt(Cursor, End, Encoded))
+					return false;
+
+				PreviousValue += ZigZagDecode(Encoded);
+				Delta = PreviousValue * Info.QuantizationScale;
+			}
+
+			// Rebuild the voxel position from its linear index inside the bounds
+			const FIntVector Local(
+				int32(LinearIndex % SizeX),
+				int32((LinearIndex / SizeX) % SizeY),
+				int32(LinearIndex / (SizeX * SizeY))
+			);
+			OutModifications.Add(Info.BoundsMin + Local, Delta);
+		}
+
+		Decoded += Count;
+		NextIndex = LinearIndex;
+	}
+
+	return true;
+}
+
+// Parse the old CSV text format (X,Y,Z,Density per line) without building intermediate strings
+bool FChunkEditStore::DecodeLegacyText(const uint8* Data, int64 DataSize, TMap<FIntVector, float>& OutModifications)
+{
+	int64 LineStart = 0;
+	while (LineStart < DataSize)
+	{
+		// Find the end of the current line
+		int64 LineEnd = LineStart;
+		while (LineEnd < DataSize && Data[LineEnd] != '\n')
+		{
+			++LineEnd;
+		}
+
+		// Copy the line into a small null-terminated stack buffer and split it on commas
+		ANSICHAR Line[128];
+		const int32 LineLength = (int32)FMath::Min<int64>(LineEnd - LineStart, UE_ARRAY_COUNT(Line) - 1);
+		FMemory::Memcpy(Line, Data + LineStart, LineLength);
+		Line[LineLength] = '\0';
+
+		const ANSICHAR* Parts[4];
+		int32 PartCount = 0;
+		Parts[PartCount++] = Line;
+		for (int32 c = 0; c < LineLength && PartCount < 4; ++c)
+		{
+			if (Line[c] == ',')
+			{
+				Line[c] = '\0';
+				Parts[PartCount++] = Line + c + 1;
+			}
+		}
+
+		if (PartCount == 4)
+		{
+			FIntVector Pos(
+				FCStringAnsi::Atoi(Parts[0]),
+				FCStringAnsi::Atoi(Parts[1]),
+				FCStringAnsi::Atoi(Parts[2])
+			);
+			OutModifications.Add(Pos, FCStringAnsi::Atof(Parts[3]));
+		}
+
+		LineStart = LineEnd + 1;
+	}
+
+	return true;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Binary on-disk store for the voxel density modifications of a single chunk.
+// Each chunk picks the smallest of several codecs (raw records, quantized run-length
+// packed stream, packed stream + zlib/Oodle) and records its choice in the file header.
+struct FChunkEditStore
+{
+	// Build the save file path of the chunk at the given chunk coordinates, in the directory of the world config hash
+	static FString GetChunkFileName(uint32 WorldHash, const FIntVector& ChunkCoord);
+
+	// Move the save files written before saves were keyed by the world config into the directory of a world.
+	// Only call it for the world they were made in, a file already saved in its directory is kept instead
+	static void MigrateLegacySaves(uint32 WorldHash);
+
+	// List the chunks of a world that have a save file
+	static void FindSavedChunks(uint32 WorldHash, TSet<FIntVector>& OutChunkCoords);
+
+	// Write the modifications on a worker thread. At most one save per file is in flight, the modifications
+	// passed while it runs replace each other and the latest ones are written once it finishes
+	static void SaveAsync(const FString& FileName, TMap<FIntVector, float> Modifications);
+
+	// Write the modifications to disk (called from a worker thread with a private copy)
+	static bool Save(const FString& FileName, const TMap<FIntVector, float>& Modifications);
+
+	// Read the modifications of a chunk, memory-mapping the file when the platform allows it.
+	// While a save of the file is in flight the modifications it is writing are returned instead
+	static bool Load(const FString& FileName, TMap<FIntVector, float>& OutModifications);
+
+private:
+	// Save directory of a world
+	static FString GetSaveDir(uint32 WorldHash);
+
+	// Directory of the saves written before they were keyed by the world config
+	static FString GetLegacySaveDir();
+
+	// Header fields needed to walk a packed stream
+	struct FPackedInfo
+	{
+		uint32 RecordCount = 0;
+		uint8 QuantizationBits = 32;
+		float QuantizationScale = 1.0f;
+		FIntVector BoundsMin = FIntVector::ZeroValue;
+		FIntVector BoundsSize = FIntVector::ZeroValue;
+	};
+
+	// Decode a binary edit store straight from memory into the modification map
+	static bool Decode(const uint8* Data, int64 DataSize, TMap<FIntVector, float>& OutModifications);
+
+	// Decode fixed size records
+	static bool DecodeRaw(const uint8* Data, int64 DataSize, uint32 RecordCount, TMap<FIntVector, float>& OutModifications);
+
+	// Walk the packed run stream and add every modification as soon as it is decoded
+	static bool DecodePacked(const uint8* Data, int64 DataSize, const FPackedInfo& Info, TMap<FIntVector, float>& OutModifications);
+
+	// Parse the old CSV text format so saves made before the binary store still load
+	static bool DecodeLegacyText(const uint8* Data, int64 DataSize, TMap<FIntVector, float>& OutModifications);
+};
@@ -0,0 +1,215 @@
+#include "ChunkMeshCache.h"
+#include "DensityPyramid.h"
+#include "TerrainStats.h"
+#include "Async/Async.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include <atomic>
+
+namespace
+{
+	// "VXMC" tag written at the start of every cache entry
+	constexpr uint32 MeshCacheMagic = 0x434D5856;
+	constexpr uint32 MeshCacheVersion = 1;
+
+	std::atomic<int64> Budget(512ll * 1024 * 1024);
+	std::atomic<int64> BytesSinceTrim(0);
+	std::atomic<bool> bTrimRunning(false);
+
+	FString GetCacheDir()
+	{
+		return FPaths::ProjectSavedDir() / TEXT("TerrainMeshCache");
+	}
+
+	void SerializeMesh(FArchive& Ar, FThreadMeshData& Mesh)
+	{
+		Ar << Mesh.VertexCount;
+		Ar << Mesh.Positions;
+		Ar << Mesh.Normals;
+		Ar << Mesh.Colors;
+		Ar << Mesh.Triangles;
+	}
+
+	// A corrupt entry must not reach the renderer: every stream has one value per vertex (colors are optional)
+	// and the index list is made of whole triangles pointing at existing vertices
+	bool IsMeshValid(const FThreadMeshData& Mesh)
+	{
+		if (Mesh.VertexCount < 0 || Mesh.Positions.Num() != Mesh.VertexCount || Mesh.Normals.Num() != Mesh.VertexCount)
+			return false;
+
+		if (Mesh.Colors.Num() != 0 && Mesh.Colors.Num() != Mesh.VertexCount)
+			return false;
+
+		if (Mesh.Triangles.Num() % 3 != 0)
+			return false;
+
+		for (const int32 Index : Mesh.Triangles)
+		{
+			if (Index < 0 || Index >= Mesh.VertexCount)
+				return false;
+		}
+		return true;
+	}
+
+	// Header, bitmaps, density ranges and both meshes, in that order
+	void SerializeEntry(FArchive& Ar, FChunkMeshResult& Result)
+	{
+		uint32 Magic = MeshCacheMagic;
+		uint32 Version = MeshCacheVersion;
+		Ar << Magic;
+		Ar << Version;
+		if (Magic != MeshCacheMagic || Version != MeshCacheVersion)
+		{
+			Ar.SetError();
+			return;
+		}
+
+		Ar << Result.SurfaceBricks;
+		Ar << Result.EmptyBricks;
+		Ar << Result.Ranges;
+		SerializeMesh(Ar, Result.Surface);
+		SerializeMesh(Ar, Result.Caps);
+	}
+}
+
+// Path of the cache entry of a chunk
+FString FChunkMeshCache::GetFileName(uint32 WorldHash, const FKey& Key)
+{
+	return FString::Printf(TEXT("%s/%08x/L%d_%d_%d_%d_%02x%s_%016llx.mesh"),
+		*GetCacheDir(), WorldHash, Key.Level, Key.Coord.X, Key.Coord.Y, Key.Coord.Z,
+		Key.TransitionFaces, Key.bDebugColors ? TEXT("c") : TEXT(""), Key.EditVersion);
+}
+
+// Read an entry into the meshes and density summaries of a result
+bool FChunkMeshCache::Load(const FString& FileName, int32 Resolution, int32 BrickCount, FChunkMeshResult& OutResult)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TerrainMeshCacheLoad);
+	TRACE_CPUPROFILER_EVENT_SCOPE(FChunkMeshCache::Load);
+
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *FileName, FILEREAD_Silent))
+		return false;
+
+	FMemoryReader Reader(Bytes);
+	SerializeEntry(Reader, OutResult);
+	if (Reader.IsError() || OutResult.SurfaceBricks.Num() != BrickCount || OutResult.EmptyBricks.Num() != BrickCount
+		|| !OutResult.Ranges.IsValid(Resolution) || !IsMeshValid(OutResult.Surface) || !IsMeshValid(OutResult.Caps))
+	{
+		// A miss: the chunk is generated again and saves a fresh entry in place of this one
+		IFileManager::Get().Delete(*FileName, false, false, true);
+
+		// Leave the result as a generation job expects it, the pooled buffers keep their capacity
+		OutResult.Surface.Reset();
+		OutResult.Caps.Reset();
+		OutResult.SurfaceBricks.Empty();
+		OutResult.EmptyBricks.Empty();
+		OutResult.Ranges = FDensityPyramid();
+		return false;
+	}
+	OutResult.bHasSummaries = true;
+
+	// Mark the entry as recently used for the eviction
+	IFileManager::Get().SetTimeStamp(*FileName, FDateTime::UtcNow());
+	return true;
+}
+
+// Write an entry once the chunk has been generated
+bool FChunkMeshCache::Save(const FString& FileName, const FChunkMeshResult& Result)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TerrainMeshCacheSave);
+	TRACE_CPUPROFILER_EVENT_SCOPE(FChunkMeshCache::Save);
+
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	// Serialization is symmetric, saving doesn't modify the data
+	SerializeEntry(Writer, const_cast<FChunkMeshResult&>(Result));
+
+	// Write next to the entry then move it in place, so a job loading it never reads half a file.
+	// The temporary name is unique: two chunks of the same node (a retiring one and its respawn) may save at once
+	const FString Directory = FPaths::GetPath(FileName);
+	IFileManager::Get().MakeDirectory(*Directory, true);
+	const FString TempFileName = FPaths::CreateTempFilename(*Directory, TEXT("Entry"), TEXT(".tmp"));
+	if (!FFileHelper::SaveArrayToFile(Bytes, *TempFileName) || !IFileManager::Get().Move(*FileName, *TempFileName, true, true))
+	{
+		IFileManager::Get().Delete(*TempFileName, false, false, true);
+		return false;
+	}
+
+	// Trim every time an eighth of the budget has been written
+	if (BytesSinceTrim.fetch_add(Bytes.Num()) + Bytes.Num() > Budget.load() / 8)
+	{
+		BytesSinceTrim.store(0);
+		TrimAsync();
+	}
+	return true;
+}
+
+// Disk space the cache may use
+void FChunkMeshCache::SetBudget(int64 Bytes)
+{
+	Budget.store(FMath::Max<int64>(Bytes, 0));
+}
+
+// Delete the least recently used entries until the cache fits its budget
+void FChunkMeshCache::TrimAsync()
+{
+	// One trim at a time, a later one would only find the same files
+	if (bTrimRunning.exchange(true))
+		return;
+
+	Async(EAsyncExecution::ThreadPool, []()
+	{
+		struct FEntry
+		{
+			FString FileName;
+			int64 Size;
+			FDateTime LastUse;
+		};
+
+		TArray<FEntry> Entries;
+		TArray<FString> StaleTempFiles;
+		int64 TotalSize = 0;
+		const FDateTime StaleTime = FDateTime::UtcNow() - FTimespan::FromHours(1.0);
+		IFileManager::Get().IterateDirectoryStatRecursively(*GetCacheDir(), [&Entries, &StaleTempFiles, &TotalSize, StaleTime](const TCHAR* FileName, const FFileStatData& Stat)
+		{
+			if (Stat.bIsDirectory)
+				return true;
+
+			const FString Extension = FPaths::GetExtension(FileName);
+			if (Extension == TEXT("mesh"))
+			{
+				Entries.Add({ FileName, Stat.FileSize, Stat.ModificationTime });
+				TotalSize += Stat.FileSize;
+			}
+			// Left behind by a save that was interrupted before its move
+			else if (Extension == TEXT("tmp") && Stat.ModificationTime < StaleTime)
+			{
+				StaleTempFiles.Add(FileName);
+			}
+			return true;
+		});
+
+		for (const FString& FileName : StaleTempFiles)
+		{
+			IFileManager::Get().Delete(*FileName, false, false, true);
+		}
+
+		// Oldest first
+		Entries.Sort([](const FEntry& A, const FEntry& B) { return A.LastUse < B.LastUse; });
+		for (const FEntry& Entry : Entries)
+		{
+			if (TotalSize <= Budget.load())
+				break;
+
+			if (IFileManager::Get().Delete(*Entry.FileName, false, false, true))
+			{
+				TotalSize -= Entry.Size;
+			}
+		}
+
+		bTrimRunning.store(false);
+	});
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ChunkMesher.h"
+
+// On-disk cache of generated chunk meshes under Saved/TerrainMeshCache, so returning to a known area loads
+// the mesh instead of sampling the noise and meshing again. An entry is keyed by the world config hash, the
+// octree node, its transition faces and the version of its edits; it also holds the density summaries the
+// chunk needs to be edited afterwards. The least recently used entries are deleted past the disk budget.
+struct FChunkMeshCache
+{
+	// Everything besides the world hash that decides the mesh of a chunk
+	struct FKey
+	{
+		int32 Level = 0;
+		FIntVector Coord = FIntVector::ZeroValue; // in nodes of the level
+		uint8 TransitionFaces = 0;
+		bool bDebugColors = false;
+		uint64 EditVersion = 0; // digest of the modifications, 0 when there are none
+
+		bool operator==(const FKey& Other) const
+		{
+			return Level == Other.Level && Coord == Other.Coord && TransitionFaces == Other.TransitionFaces
+				&& bDebugColors == Other.bDebugColors && EditVersion == Other.EditVersion;
+		}
+
+		friend uint32 GetTypeHash(const FKey& Key)
+		{
+			return HashCombine(HashCombine(GetTypeHash(Key.Coord), GetTypeHash(Key.Level)),
+				HashCombine(GetTypeHash(Key.TransitionFaces | (Key.bDebugColors ? 0x100 : 0)), GetTypeHash(Key.EditVersion)));
+		}
+	};
+
+	// Path of the cache entry of a chunk
+	static FString GetFileName(uint32 WorldHash, const FKey& Key);
+
+	// Read an entry into the meshes and density summaries of a result, false if it is missing, or if it is
+	// corrupt or made for another grid size: such an entry is deleted. Called from mesh jobs
+	static bool Load(const FString& FileName, int32 Resolution, int32 BrickCount, FChunkMeshResult& OutResult);
+
+	// Write an entry, called from mesh jobs once the chunk has been generated
+	static bool Save(const FString& FileName, const FChunkMeshResult& Result);
+
+	// Disk space the cache may use, the oldest entries are deleted past it
+	static void SetBudget(int64 Bytes);
+
+	// Delete the least recently used entries until the cache fits its budget, on a worker thread
+	static void TrimAsync();
+};
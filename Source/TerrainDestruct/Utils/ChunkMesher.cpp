@@ -0,0 +1,463 @@
+#include "ChunkMesher.h"
+#include "TerrainStats.h"
+#include "DensityPyramid.h"
+#include "MarchingCubesTables.h"
+#include "TerrainVertex.h"
+
+namespace
+{
+	// Free mesh output buffers, shared by every chunk
+	FCriticalSection MeshBufferPoolLock;
+	TArray<FThreadMeshData> MeshBufferPool;
+
+	// Past this many free buffers released ones are simply freed
+	constexpr int32 MaxPooledMeshBuffers = 64;
+}
+
+// Scratch of the calling worker thread
+FMeshScratch& FMeshScratch::Get()
+{
+	thread_local FMeshScratch Scratch;
+	return Scratch;
+}
+
+// Take a free buffer set, it keeps the capacity of the mesh it last held
+FThreadMeshData FMeshBufferPool::Acquire()
+{
+	FScopeLock Lock(&MeshBufferPoolLock);
+	if (MeshBufferPool.Num() == 0)
+		return FThreadMeshData();
+
+	FThreadMeshData Buffers = MeshBufferPool.Pop(EAllowShrinking::No);
+	Buffers.Reset();
+	return Buffers;
+}
+
+// Give buffers back once their mesh has been replaced
+void FMeshBufferPool::Release(FThreadMeshData&& Buffers)
+{
+	FScopeLock Lock(&MeshBufferPoolLock);
+	if (MeshBufferPool.Num() < MaxPooledMeshBuffers)
+	{
+		MeshBufferPool.Add(MoveTemp(Buffers));
+	}
+}
+
+FChunkMesher::FChunkMesher(const FChunkSnapshot& InSnapshot, const TArray<float>& InDensity)
+	: Snapshot(InSnapshot)
+	, Density(InDensity)
+	, ColorStream(InSnapshot.ColorSeed)
+{
+	check(Density.Num() == (Snapshot.Resolution + 1) * (Snapshot.Resolution + 1) * (Snapshot.Resolution + 1));
+
+	// Set triangle winding order based on surface level sign
+	if (Snapshot.SurfaceLevel > 0.0f)
+	{
+		TriangleOrder[0] = 0;
+		TriangleOrder[1] = 1;
+		TriangleOrder[2] = 2;
+	}
+	else
+	{
+		TriangleOrder[0] = 2;
+		TriangleOrder[1] = 1;
+		TriangleOrder[2] = 0;
+	}
+}
+
+// Mesh the surface, only visiting the blocks of Ranges that cross it
+void FChunkMesher::GenerateMesh(const FDensityPyramid& Ranges, FThreadMeshData& Out)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TerrainGenerateMesh);
+	TRACE_CPUPROFILER_EVENT_SCOPE(FChunkMesher::GenerateMesh);
+
+	const float surfaceLevel = Snapshot.SurfaceLevel;
+
+	// Cells crossed by the surface, found block by block
+	TArray<FActiveCell>& activeCells = FMeshScratch::Get().ActiveCells;
+	activeCells.Reset();
+
+	// Only visit the coarse then fine blocks whose density range crosses the surface
+	const int32 coarseBlocks = Ranges.GetCoarseBlocksPerAxis();
+	const int32 fineBlocks = Ranges.GetFineBlocksPerAxis();
+	const int32 finePerCoarse = FDensityPyramid::CoarseBlockSize / FDensityPyramid::FineBlockSize;
+
+	for (int32 CBZ = 0; CBZ < coarseBlocks; ++CBZ)
+	{
+		for (int32 CBY = 0; CBY < coarseBlocks; ++CBY)
+		{
+			for (int32 CBX = 0; CBX < coarseBlocks; ++CBX)
+			{
+				if (!Ranges.CoarseBlockStraddles(CBX, CBY, CBZ, surfaceLevel))
+					continue;
+
+				for (int32 FBZ = CBZ * finePerCoarse; FBZ < FMath::Min((CBZ + 1) * finePerCoarse, fineBlocks); ++FBZ)
+				{
+					for (int32 FBY = CBY * finePerCoarse; FBY < FMath::Min((CBY + 1) * finePerCoarse, fineBlocks); ++FBY)
+					{
+						for (int32 FBX = CBX * finePerCoarse; FBX < FMath::Min((CBX + 1) * finePerCoarse, fineBlocks); ++FBX)
+						{
+							if (!Ranges.FineBlockStraddles(FBX, FBY, FBZ, surfaceLevel))
+								continue;
+
+							int32 x0, x1, y0, y1, z0, z1;
+							Ranges.GetFineBlockCells(FBX, x0, x1);
+							Ranges.GetFineBlockCells(FBY, y0, y1);
+							Ranges.GetFineBlockCells(FBZ, z0, z1);
+							ClassifyBlock(FIntVector(x0, y0, z0), FIntVector(x1, y1, z1), activeCells);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	BuildSurfaceMesh(activeCells, Out);
+}
+
+// Classify the cells between Min and Max (excluded) of one fine block.
+// The block's corners are gathered once and compared a whole row at a time with vector compares,
+// only the cells the surface crosses are added to ActiveCells.
+void FChunkMesher::ClassifyBlock(const FIntVector& Min, const FIntVector& Max, TArray<FActiveCell>& ActiveCells) const
+{
+	constexpr int32 TilePoints = FDensityPyramid::FineBlockSize + 1;
+	constexpr int32 TileRow = 8; // two vector registers per row
+	static_assert(TilePoints <= TileRow, "A block row must fit in the inside bit mask");
+
+	// Corner densities of the block with modifications applied, padded rows
+	alignas(16) float tile[TilePoints][TilePoints][TileRow];
+	const FIntVector points = Max - Min + FIntVector(1);
+	for (int32 pz = 0; pz < points.Z; ++pz)
+	{
+		for (int32 py = 0; py < points.Y; ++py)
+		{
+			float* row = tile[pz][py];
+			for (int32 px = 0; px < points.X; ++px)
+			{
+				row[px] = GetDensity(Min.X + px, Min.Y + py, Min.Z + pz);
+			}
+			for (int32 px = points.X; px < TileRow; ++px)
+			{
+				row[px] = Snapshot.SurfaceLevel;
+			}
+		}
+	}
+
+	// Inside bits of every row (bit x set when the corner is at or below the surface)
+	uint8 inside[TilePoints][TilePoints];
+	const VectorRegister4Float surface = VectorSetFloat1(Snapshot.SurfaceLevel);
+	for (int32 pz = 0; pz < points.Z; ++pz)
+	{
+		for (int32 py = 0; py < points.Y; ++py)
+		{
+			const float* row = tile[pz][py];
+			const uint32 low = VectorMaskBits(VectorCompareLE(VectorLoadAligned(row), surface));
+			const uint32 high = VectorMaskBits(VectorCompareLE(VectorLoadAligned(row + 4), surface));
+			inside[pz][py] = (uint8)(low | (high << 4));
+		}
+	}
+
+	// Derive the case index of every cell from the row bits and keep the ones crossing the surface
+	const FIntVector cells = Max - Min;
+	for (int32 cz = 0; cz < cells.Z; ++cz)
+	{
+		for (int32 cy = 0; cy < cells.Y; ++cy)
+		{
+			// Row bits of each corner, shifted so bit cx belongs to cell cx
+			uint32 cornerRows[8];
+			for (int32 i = 0; i < 8; ++i)
+			{
+				cornerRows[i] = inside[cz + MarchingCubes::VertexOffset[i][2]][cy + MarchingCubes::VertexOffset[i][1]] >> MarchingCubes::VertexOffset[i][0];
+			}
+
+			for (int32 cx = 0; cx < cells.X; ++cx)
+			{
+				uint32 cubeIndex = 0;
+				for (int32 i = 0; i < 8; ++i)
+				{
+					cubeIndex |= ((cornerRows[i] >> cx) & 1) << i;
+				}
+
+				if (cubeIndex != 0 && cubeIndex != 255)
+				{
+					ActiveCells.Add({ (uint16)(Min.X + cx), (uint16)(Min.Y + cy), (uint16)(Min.Z + cz), (uint8)cubeIndex });
+				}
+			}
+		}
+	}
+}
+
+// Build the surface of the active cells straight into pre-sized buffers.
+// A first pass counts the triangles and gives each crossed grid edge a vertex index, so neighbouring cells
+// share their edge vertices; the prefix sum of the triangle counts gives every cell its output offset,
+// and the write passes fill the buffers in place without any merging or deduplication afterwards.
+void FChunkMesher::BuildSurfaceMesh(const TArray<FActiveCell>& ActiveCells, FThreadMeshData& Out)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TerrainMarch);
+	TRACE_CPUPROFILER_EVENT_SCOPE(FChunkMesher::BuildSurfaceMesh);
+
+	const int32 dim = Snapshot.Resolution + 1;
+	FMeshScratch& scratch = FMeshScratch::Get();
+
+	// Vertex index of every grid edge (3 edges per grid point, along +X, +Y and +Z), -1 when not crossed
+	TArray<int32>& edgeVertex = scratch.EdgeVertex;
+	edgeVertex.SetNumUninitialized(dim * dim * dim * 3, EAllowShrinking::No);
+	FMemory::Memset(edgeVertex.GetData(), 0xFF, edgeVertex.Num() * sizeof(int32));
+
+	// Grid edge of every vertex
+	TArray<int32>& vertexEdges = scratch.VertexEdges;
+	vertexEdges.Reset();
+
+	// First triangle of every active cell
+	TArray<int32>& triangleOffsets = scratch.TriangleOffsets;
+	triangleOffsets.SetNumUninitialized(ActiveCells.Num(), EAllowShrinking::No);
+
+	// Count pass: prefix sum of the triangle counts and vertex allocation
+	int32 triangleCount = 0;
+	for (int32 c = 0; c < ActiveCells.Num(); ++c)
+	{
+		const FActiveCell& cell = ActiveCells[c];
+		triangleOffsets[c] = triangleCount;
+		triangleCount += MarchingCubes::CaseTable.TriangleCount[cell.CubeIndex];
+
+		const int8* edges = MarchingCubes::CaseTable.Edges[cell.CubeIndex];
+		for (int32 e = 0; e < MarchingCubes::CaseTable.EdgeCount[cell.CubeIndex]; ++e)
+		{
+			const int32 key = GetEdgeKey(cell, edges[e]);
+			if (edgeVertex[key] == INDEX_NONE)
+			{
+				edgeVertex[key] = vertexEdges.Add(key);
+			}
+		}
+	}
+
+	// Size the output once, colors are only written for debugging
+	const int32 vertexCount = vertexEdges.Num();
+	Out.Positions.SetNumUninitialized(vertexCount, EAllowShrinking::No);
+	Out.Normals.SetNumUninitialized(vertexCount, EAllowShrinking::No);
+	Out.Colors.SetNumUninitialized(Snapshot.bDebugColors ? vertexCount : 0, EAllowShrinking::No);
+	Out.Triangles.SetNumUninitialized(triangleCount * 3, EAllowShrinking::No);
+	Out.VertexCount = vertexCount;
+
+	// Face normals are summed in full precision before being packed
+	TArray<FVector3f>& normalSums = scratch.NormalSums;
+	normalSums.SetNumZeroed(vertexCount, EAllowShrinking::No);
+	const float scale = 100.0f * Snapshot.Stride;
+
+	// Vertex pass: interpolate the surface crossing along each edge
+	for (int32 v = 0; v < vertexCount; ++v)
+	{
+		const int32 point = vertexEdges[v] / 3;
+		const int32 axis = vertexEdges[v] % 3;
+		const FIntVector start(point % dim, (point / dim) % dim, point / (dim * dim));
+		FIntVector end = start;
+		end[axis] += 1;
+
+		const float offset = GetInterpolationOffset(GetDensity(start.X, start.Y, start.Z), GetDensity(end.X, end.Y, end.Z));
+
+		// Multiply by 100 for UE units
+		FVector3f position(start);
+		position[axis] += offset;
+		Out.Positions[v] = position * scale;
+
+		// Assign a random color to each vertex (for debugging)
+		if (Snapshot.bDebugColors)
+		{
+			Out.Colors[v] = MakeDebugColor();
+		}
+	}
+
+	// Triangle pass: every cell writes at its own offset and adds its face normals to its vertices
+	for (int32 c = 0; c < ActiveCells.Num(); ++c)
+	{
+		const FActiveCell& cell = ActiveCells[c];
+		const int8* triangleEdges = MarchingCubes::TriangleConnectionTable[cell.CubeIndex];
+		int32* out = &Out.Triangles[triangleOffsets[c] * 3];
+
+		for (int32 t = 0; t < MarchingCubes::CaseTable.TriangleCount[cell.CubeIndex]; ++t)
+		{
+			const int32 corners[3] = {
+				edgeVertex[GetEdgeKey(cell, triangleEdges[3 * t])],
+				edgeVertex[GetEdgeKey(cell, triangleEdges[3 * t + 1])],
+				edgeVertex[GetEdgeKey(cell, triangleEdges[3 * t + 2])]
+			};
+
+			// Add triangle indices with proper winding order
+			out[3 * t] = corners[TriangleOrder[0]];
+			out[3 * t + 1] = corners[TriangleOrder[1]];
+			out[3 * t + 2] = corners[TriangleOrder[2]];
+
+			// Calculate surface normal from cross product of triangle edges (table order points out of the solid)
+			FVector3f normal = FVector3f::CrossProduct(
+				Out.Positions[corners[1]] - Out.Positions[corners[0]],
+				Out.Positions[corners[2]] - Out.Positions[corners[0]]);
+			if (normal.Normalize())
+			{
+				normalSums[corners[0]] += normal;
+				normalSums[corners[1]] += normal;
+				normalSums[corners[2]] += normal;
+			}
+		}
+	}
+
+	// Normalize all accumulated normals and pack them
+	for (int32 v = 0; v < vertexCount; ++v)
+	{
+		FVector3f normal = normalSums[v];
+		if (!normal.Normalize())
+			normal = FVector3f::UpVector;
+		Out.Normals[v] = TerrainVertex::PackNormal(normal);
+	}
+}
+
+// Close the solid cross-section of the chunk on faces bordering a chunk of another level of detail.
+// The two resolutions don't meet exactly on the shared face, the caps hide the crack between them.
+void FChunkMesher::GenerateTransitionCaps(FThreadMeshData& Out)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TerrainTransitionCaps);
+	TRACE_CPUPROFILER_EVENT_SCOPE(FChunkMesher::GenerateTransitionCaps);
+
+	const int32 resolution = Snapshot.Resolution;
+	const float scale = 100.0f * Snapshot.Stride;
+
+	// Corners of a face square, in order around it
+	const int32 cornerU[4] = {0, 1, 1, 0};
+	const int32 cornerV[4] = {0, 0, 1, 1};
+
+	for (int32 face = 0; face < 6; ++face)
+	{
+		if ((Snapshot.TransitionFaces & (1 << face)) == 0)
+			continue;
+
+		// Faces are ordered -X, +X, -Y, +Y, -Z, +Z
+		const int32 axis = face / 2;
+		const bool bPositive = (face & 1) != 0;
+		const int32 uAxis = (axis + 1) % 3;
+		const int32 vAxis = (axis + 2) % 3;
+
+		FVector3f outward = FVector3f::ZeroVector;
+		outward[axis] = bPositive ? 1.0f : -1.0f;
+
+		// Run marching squares on the face and fill the solid part of every square
+		for (int32 u = 0; u < resolution; ++u)
+		{
+			for (int32 v = 0; v < resolution; ++v)
+			{
+				FIntVector corners[4];
+				float values[4];
+				for (int32 k = 0; k < 4; ++k)
+				{
+					corners[k][axis] = bPositive ? resolution : 0;
+					corners[k][uAxis] = u + cornerU[k];
+					corners[k][vAxis] = v + cornerV[k];
+					values[k] = GetDensity(corners[k].X, corners[k].Y, corners[k].Z);
+				}
+
+				// Walk around the square keeping solid corners and surface crossings (always a convex polygon)
+				FVector3f polygon[8];
+				int32 count = 0;
+				for (int32 k = 0; k < 4; ++k)
+				{
+					const int32 next = (k + 1) % 4;
+					const bool bSolid = values[k] > Snapshot.SurfaceLevel;
+
+					if (bSolid)
+					{
+						polygon[count++] = FVector3f(corners[k]);
+					}
+					if (bSolid != (values[next] > Snapshot.SurfaceLevel))
+					{
+						const float offset = GetInterpolationOffset(values[k], values[next]);
+						polygon[count++] = FMath::Lerp(FVector3f(corners[k]), FVector3f(corners[next]), offset);
+					}
+				}
+
+				// Fan triangulate, winding each triangle like the surface so the cap faces away from the chunk
+				for (int32 i = 1; i + 1 < count; ++i)
+				{
+					FVector3f V1 = polygon[0] * scale;
+					FVector3f V2 = polygon[i] * scale;
+					FVector3f V3 = polygon[i + 1] * scale;
+					if (FVector3f::DotProduct(FVector3f::CrossProduct(V2 - V1, V3 - V1), outward) < 0.0f)
+					{
+						Swap(V2, V3);
+					}
+
+					AddTriangle(V1, V2, V3, outward, Out);
+				}
+			}
+		}
+	}
+}
+
+// Append a triangle with a flat normal to the mesh data
+void FChunkMesher::AddTriangle(const FVector3f& V1, const FVector3f& V2, const FVector3f& V3, const FVector3f& Normal, FThreadMeshData& Out)
+{
+	// Add the three vertices to the mesh data
+	Out.Positions.Append({V1, V2, V3});
+
+	// Add triangle indices with proper winding order
+	Out.Triangles.Append({ Out.VertexCount + TriangleOrder[0],
+	                       Out.VertexCount + TriangleOrder[1],
+	                       Out.VertexCount + TriangleOrder[2] });
+
+	// Add normals for each vertex
+	const uint32 PackedNormal = TerrainVertex::PackNormal(Normal);
+	Out.Normals.Append({PackedNormal, PackedNormal, PackedNormal});
+
+	// Assign a random color to each triangle (for debugging)
+	if (Snapshot.bDebugColors)
+	{
+		const FColor Color = MakeDebugColor();
+		Out.Colors.Append({Color, Color, Color});
+	}
+	Out.VertexCount += 3;
+}
+
+// Density of a grid point with the modifications applied
+float FChunkMesher::GetDensity(int32 X, int32 Y, int32 Z) const
+{
+	// Get base density from noise
+	float BaseDensity = Density[GetVoxelIndex(X, Y, Z)];
+
+	// Add any modifications made by the player (stored at full resolution)
+	if (!Snapshot.Edits.IsEmpty())
+	{
+		BaseDensity += Snapshot.Edits.Get(FIntVector(X, Y, Z) * Snapshot.Stride);
+	}
+
+	return BaseDensity;
+}
+
+// Calculate linear interpolation offset between two density values to find surface crossing point
+float FChunkMesher::GetInterpolationOffset(float V1, float V2) const
+{
+	const float delta = V2 - V1;
+	// Avoid division by zero
+	if (fabsf(delta) < 1e-6f)
+		return 0.5f;
+
+	// Clamp interpolation to valid range [0, 1]
+	const float t = (Snapshot.SurfaceLevel - V1) / delta;
+	return FMath::Clamp(t, 0.0f, 1.0f);
+}
+
+// Convert 3D voxel coordinates to a 1D array index
+int32 FChunkMesher::GetVoxelIndex(int32 X, int32 Y, int32 Z) const
+{
+	const int32 dim = Snapshot.Resolution + 1;
+	return Z * dim * dim + Y * dim + X;
+}
+
+// Key of a cell edge in the chunk's grid edges, the same for every cell sharing the edge
+int32 FChunkMesher::GetEdgeKey(const FActiveCell& Cell, int32 Edge) const
+{
+	const int8* origin = MarchingCubes::EdgeOrigin[Edge];
+	return GetVoxelIndex(Cell.X + origin[0], Cell.Y + origin[1], Cell.Z + origin[2]) * 3 + origin[3];
+}
+
+// Random saturated color from the mesher's own stream, the global RNG is not safe on worker threads
+FColor FChunkMesher::MakeDebugColor()
+{
+	return FLinearColor::MakeFromHSV8((uint8)ColorStream.RandRange(0, 255), 255, 255).ToFColor(true);
+}
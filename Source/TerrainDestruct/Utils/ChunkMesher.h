@@ -0,0 +1,126 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VoxelEditBricks.h"
+#include "DensityPyramid.h"
+#include "TerrainWorldConfig.h"
+
+class FTerrainSampleCache;
+struct FChunkDensityCache;
+
+// Mesh output in the compact vertex format of TerrainVertex.h
+struct FThreadMeshData
+{
+	TArray<FVector3f> Positions; // relative to the chunk origin
+	TArray<int32> Triangles;
+	TArray<uint32> Normals; // octahedral encoded
+	TArray<FColor> Colors; // empty unless debug coloring is on
+	int32 VertexCount = 0;
+
+	void Reset()
+	{
+		Positions.Reset();
+		Triangles.Reset();
+		Normals.Reset();
+		Colors.Reset();
+		VertexCount = 0;
+	}
+};
+
+// A cell crossed by the surface, found by the classification pass of the mesher
+struct FActiveCell
+{
+	uint16 X, Y, Z;
+	uint8 CubeIndex;
+};
+
+// Per worker scratch buffers, reused by every mesh job running on that thread.
+// Arrays are only reset between jobs so they keep the capacity reached by previous runs.
+struct FMeshScratch
+{
+	TArray<float> Density;
+	TArray<FActiveCell> ActiveCells;
+	TArray<int32> EdgeVertex;
+	TArray<int32> VertexEdges;
+	TArray<int32> TriangleOffsets;
+	TArray<FVector3f> NormalSums;
+
+	// Scratch of the calling worker thread
+	static FMeshScratch& Get();
+};
+
+// Recycled mesh output buffers, so new jobs write into arrays already sized by earlier meshes
+struct FMeshBufferPool
+{
+	// Take a free buffer set, it keeps the capacity of the mesh it last held
+	static FThreadMeshData Acquire();
+
+	// Give buffers back once their mesh has been replaced
+	static void Release(FThreadMeshData&& Buffers);
+};
+
+// Output of a full chunk mesh job
+struct FChunkMeshResult
+{
+	FThreadMeshData Surface;
+	FThreadMeshData Caps; // transition caps, see FChunkMesher::GenerateTransitionCaps
+
+	// Density summaries of a generation job, handed to the chunk on the game thread with the mesh
+	bool bHasSummaries = false;
+	FDensityPyramid Ranges;
+	TBitArray<> SurfaceBricks;
+	TBitArray<> EmptyBricks;
+};
+
+// Everything a mesh job reads. It is captured on the game thread when the job is launched and never
+// modified afterwards, so jobs share no mutable state with the chunk actor, see ChunkDensity.h.
+struct FChunkSnapshot
+{
+	float SurfaceLevel = 0.0f;
+	int32 Resolution = 0; // cells per axis of the density grid
+	int32 Stride = 1; // voxels between two grid points
+	uint8 TransitionFaces = 0; // faces (-X, +X, -Y, +Y, -Z, +Z bits) bordering another level of detail
+	bool bDebugColors = false; // write a random color per vertex
+	int32 ColorSeed = 0; // seed of the debug colors, so a chunk keeps its colors across remeshes
+	FVoxelEditBricks Edits; // immutable version of the density deltas, in full resolution voxel coordinates
+
+	// Density inputs
+	FTerrainWorldConfigPtr Config; // noise of the world
+	TSharedPtr<FTerrainSampleCache, ESPMode::ThreadSafe> SampleCache; // samples shared with the other chunks, may be null
+	FVector NoisePosition = FVector::ZeroVector; // noise space origin of the chunk
+	TBitArray<> EmptyBricks; // side of the surface the bricks that aren't sampled are filled on
+	TSharedPtr<FChunkDensityCache, ESPMode::ThreadSafe> DensityCache; // compressed grid of the edited chunk
+};
+
+// Reentrant marching cubes mesher over an immutable chunk snapshot. Every job builds its own mesher;
+// the only memory it writes is its output and the calling thread's scratch.
+class FChunkMesher
+{
+public:
+	FChunkMesher(const FChunkSnapshot& InSnapshot, const TArray<float>& InDensity);
+
+	// Mesh the surface, only visiting the blocks of Ranges that cross it
+	void GenerateMesh(const FDensityPyramid& Ranges, FThreadMeshData& Out);
+
+	// Close the solid cross-section of the chunk on faces bordering a chunk of another level of detail
+	void GenerateTransitionCaps(FThreadMeshData& Out);
+
+private:
+	void ClassifyBlock(const FIntVector& Min, const FIntVector& Max, TArray<FActiveCell>& ActiveCells) const;
+	void BuildSurfaceMesh(const TArray<FActiveCell>& ActiveCells, FThreadMeshData& Out);
+	void AddTriangle(const FVector3f& V1, const FVector3f& V2, const FVector3f& V3, const FVector3f& Normal, FThreadMeshData& Out);
+
+	// Density of a grid point with the modifications applied
+	float GetDensity(int32 X, int32 Y, int32 Z) const;
+	float GetInterpolationOffset(float V1, float V2) const;
+	int32 GetVoxelIndex(int32 X, int32 Y, int32 Z) const;
+	int32 GetEdgeKey(const FActiveCell& Cell, int32 Edge) const;
+	FColor MakeDebugColor();
+
+	const FChunkSnapshot& Snapshot;
+	const TArray<float>& Density;
+
+	// Triangle winding, flipped when the surface level is not positive
+	int32 TriangleOrder[3];
+	FRandomStream ColorStream;
+};
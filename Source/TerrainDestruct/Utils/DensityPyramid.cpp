@@ -0,0 +1,125 @@
+#include "DensityPyramid.h"
+
+namespace
+{
+	// Fine blocks per coarse block along each axis
+	constexpr int32 FinePerCoarse = FDensityPyramid::CoarseBlockSize / FDensityPyramid::FineBlockSize;
+}
+
+// Build the ranges from a (InResolution+1)^3 point grid laid out as Z * Dim * Dim + Y * Dim + X
+void FDensityPyramid::Build(const TArray<float>& Density, int32 InResolution)
+{
+	const int32 dim = InResolution + 1;
+	check(Density.Num() == dim * dim * dim);
+
+	Resolution = InResolution;
+	FineBlocksPerAxis = FMath::DivideAndRoundUp(Resolution, FineBlockSize);
+	CoarseBlocksPerAxis = FMath::DivideAndRoundUp(Resolution, CoarseBlockSize);
+	Fine.Init(FRange(), FineBlocksPerAxis * FineBlocksPerAxis * FineBlocksPerAxis);
+	Coarse.Init(FRange(), CoarseBlocksPerAxis * CoarseBlocksPerAxis * CoarseBlocksPerAxis);
+
+	for (int32 BZ = 0; BZ < FineBlocksPerAxis; ++BZ)
+	{
+		for (int32 BY = 0; BY < FineBlocksPerAxis; ++BY)
+		{
+			for (int32 BX = 0; BX < FineBlocksPerAxis; ++BX)
+			{
+				int32 X0, X1, Y0, Y1, Z0, Z1;
+				GetFineBlockCells(BX, X0, X1);
+				GetFineBlockCells(BY, Y0, Y1);
+				GetFineBlockCells(BZ, Z0, Z1);
+
+				// The cells of the block read their far corner layer too
+				FRange& Range = Fine[GetFineIndex(BX, BY, BZ)];
+				for (int32 Z = Z0; Z <= Z1; ++Z)
+				{
+					for (int32 Y = Y0; Y <= Y1; ++Y)
+					{
+						const float* Row = &Density[(Z * dim + Y) * dim];
+						for (int32 X = X0; X <= X1; ++X)
+						{
+							Range.Min = FMath::Min(Range.Min, Row[X]);
+							Range.Max = FMath::Max(Range.Max, Row[X]);
+						}
+					}
+				}
+
+				// A coarse block is the union of its fine blocks
+				FRange& CoarseRange = Coarse[GetCoarseIndex(BX / FinePerCoarse, BY / FinePerCoarse, BZ / FinePerCoarse)];
+				CoarseRange.Min = FMath::Min(CoarseRange.Min, Range.Min);
+				CoarseRange.Max = FMath::Max(CoarseRange.Max, Range.Max);
+			}
+		}
+	}
+}
+
+// Widen the ranges of every block reading a point after its density changed by Delta
+void FDensityPyramid::Widen(int32 X, int32 Y, int32 Z, float Delta)
+{
+	if (IsEmpty())
+		return;
+
+	// A point is a corner of the cells starting at Point - 1 and Point on every axis
+	for (int32 DZ = -1; DZ <= 0; ++DZ)
+	{
+		for (int32 DY = -1; DY <= 0; ++DY)
+		{
+			for (int32 DX = -1; DX <= 0; ++DX)
+			{
+				const int32 CX = X + DX;
+				const int32 CY = Y + DY;
+				const int32 CZ = Z + DZ;
+				if (CX < 0 || CY < 0 || CZ < 0 || CX >= Resolution || CY >= Resolution || CZ >= Resolution)
+					continue;
+
+				FRange& Range = Fine[GetFineIndex(CX / FineBlockSize, CY / FineBlockSize, CZ / FineBlockSize)];
+				FRange& CoarseRange = Coarse[GetCoarseIndex(CX / CoarseBlockSize, CY / CoarseBlockSize, CZ / CoarseBlockSize)];
+				if (Delta < 0.0f)
+				{
+					Range.Min += Delta;
+					CoarseRange.Min = FMath::Min(CoarseRange.Min, Range.Min);
+				}
+				else
+				{
+					Range.Max += Delta;
+					CoarseRange.Max = FMath::Max(CoarseRange.Max, Range.Max);
+				}
+			}
+		}
+	}
+}
+
+bool FDensityPyramid::FineBlockStraddles(int32 BX, int32 BY, int32 BZ, float SurfaceLevel) const
+{
+	const FRange& Range = Fine[GetFineIndex(BX, BY, BZ)];
+	return Range.Min <= SurfaceLevel && Range.Max > SurfaceLevel;
+}
+
+bool FDensityPyramid::CoarseBlockStraddles(int32 BX, int32 BY, int32 BZ, float SurfaceLevel) const
+{
+	const FRange& Range = Coarse[GetCoarseIndex(BX, BY, BZ)];
+	return Range.Min <= SurfaceLevel && Range.Max > SurfaceLevel;
+}
+
+// Cell range covered by a block along one axis (end excluded)
+void FDensityPyramid::GetFineBlockCells(int32 BlockCoord, int32& OutStart, int32& OutEnd) const
+{
+	OutStart = BlockCoord * FineBlockSize;
+	OutEnd = FMath::Min(OutStart + FineBlockSize, Resolution);
+}
+
+void FDensityPyramid::GetCoarseBlockCells(int32 BlockCoord, int32& OutStart, int32& OutEnd) const
+{
+	OutStart = BlockCoord * CoarseBlockSize;
+	OutEnd = FMath::Min(OutStart + CoarseBlockSize, Resolution);
+}
+
+int32 FDensityPyramid::GetFineIndex(int32 BX, int32 BY, int32 BZ) const
+{
+	return (BZ * FineBlocksPerAxis + BY) * FineBlocksPerAxis + BX;
+}
+
+int32 FDensityPyramid::GetCoarseIndex(int32 BX, int32 BY, int32 BZ) const
+{
+	return (BZ * CoarseBlocksPerAxis + BY) * CoarseBlocksPerAxis + BX;
+}
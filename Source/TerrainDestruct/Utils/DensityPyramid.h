@@ -0,0 +1,68 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Conservative min/max density of blocks of cells at two levels (4^3 and 16^3 cells),
+// used by the mesher to skip whole blocks the surface can't pass through.
+class FDensityPyramid
+{
+public:
+	static constexpr int32 FineBlockSize = 4;
+	static constexpr int32 CoarseBlockSize = 16;
+
+	// Build the ranges from a (InResolution+1)^3 point grid laid out as Z * Dim * Dim + Y * Dim + X
+	void Build(const TArray<float>& Density, int32 InResolution);
+
+	// Widen the ranges of every block reading a point after its density changed by Delta.
+	// The ranges stay a superset of the real ones until the next Build.
+	void Widen(int32 X, int32 Y, int32 Z, float Delta);
+
+	// Same test as the mesher: the block may produce triangles if it has points on both sides of the surface
+	bool FineBlockStraddles(int32 BX, int32 BY, int32 BZ, float SurfaceLevel) const;
+	bool CoarseBlockStraddles(int32 BX, int32 BY, int32 BZ, float SurfaceLevel) const;
+
+	// Cell range covered by a block along one axis (end excluded)
+	void GetFineBlockCells(int32 BlockCoord, int32& OutStart, int32& OutEnd) const;
+	void GetCoarseBlockCells(int32 BlockCoord, int32& OutStart, int32& OutEnd) const;
+
+	int32 GetFineBlocksPerAxis() const { return FineBlocksPerAxis; }
+	int32 GetCoarseBlocksPerAxis() const { return CoarseBlocksPerAxis; }
+	bool IsEmpty() const { return Fine.Num() == 0; }
+	SIZE_T GetAllocatedSize() const { return Fine.GetAllocatedSize() + Coarse.GetAllocatedSize(); }
+
+	// True if the ranges were built for a grid of the given resolution, checked on the ranges read from disk
+	bool IsValid(int32 InResolution) const
+	{
+		const int32 fine = FMath::DivideAndRoundUp(InResolution, FineBlockSize);
+		const int32 coarse = FMath::DivideAndRoundUp(InResolution, CoarseBlockSize);
+		return Resolution == InResolution && FineBlocksPerAxis == fine && CoarseBlocksPerAxis == coarse
+			&& Fine.Num() == fine * fine * fine && Coarse.Num() == coarse * coarse * coarse;
+	}
+
+	// Saved with the chunk meshes of the disk cache
+	friend FArchive& operator<<(FArchive& Ar, FDensityPyramid& Pyramid)
+	{
+		return Ar << Pyramid.Resolution << Pyramid.FineBlocksPerAxis << Pyramid.CoarseBlocksPerAxis << Pyramid.Fine << Pyramid.Coarse;
+	}
+
+private:
+	struct FRange
+	{
+		float Min = MAX_flt;
+		float Max = -MAX_flt;
+
+		friend FArchive& operator<<(FArchive& Ar, FRange& Range)
+		{
+			return Ar << Range.Min << Range.Max;
+		}
+	};
+
+	int32 GetFineIndex(int32 BX, int32 BY, int32 BZ) const;
+	int32 GetCoarseIndex(int32 BX, int32 BY, int32 BZ) const;
+
+	int32 Resolution = 0;
+	int32 FineBlocksPerAxis = 0;
+	int32 CoarseBlocksPerAxis = 0;
+	TArray<FRange> Fine;
+	TArray<FRange> Coarse;
+};
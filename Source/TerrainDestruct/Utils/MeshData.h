@@ -3,15 +3,15 @@
 #include "CoreMinimal.h"
 #include "MeshData.generated.h"
 
+// Mesh held by a chunk, in the compact vertex format of TerrainVertex.h
 USTRUCT()
 struct FMeshData
 {
 	GENERATED_BODY()
-	TArray<FVector> Vertices;
+	TArray<FVector3f> Positions; // relative to the chunk origin
 	TArray<int> Triangles;
-	TArray<FVector> Normals;
-	TArray<FColor> Colors;
-	TArray<FVector2D> UV0;
+	TArray<uint32> Normals; // octahedral encoded
+	TArray<FColor> Colors; // empty unless debug coloring is on
 	int32 VertexCount = 0;
 
 	void Clear();
@@ -19,9 +19,12 @@ struct FMeshData
 
 inline void FMeshData::Clear()
 {
-	Vertices.Empty();
+	Positions.Empty();
 	Triangles.Empty();
 	Normals.Empty();
 	Colors.Empty();
-	UV0.Empty();
-}
\ No newline at end of file
+	VertexCount = 0;
+}
+
+// Mesh shared with the render thread and the collision cook, never modified once shared
+typedef TSharedPtr<FMeshData, ESPMode::ThreadSafe> FSharedMeshData;
\ No newline at end of file
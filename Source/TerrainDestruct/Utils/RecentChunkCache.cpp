@@ -0,0 +1,71 @@
+#include "RecentChunkCache.h"
+
+namespace
+{
+	SIZE_T GetMeshSize(const FSharedMeshData& Mesh)
+	{
+		if (!Mesh.IsValid())
+			return 0;
+
+		return sizeof(FMeshData) + Mesh->Positions.GetAllocatedSize() + Mesh->Triangles.GetAllocatedSize()
+			+ Mesh->Normals.GetAllocatedSize() + Mesh->Colors.GetAllocatedSize();
+	}
+}
+
+SIZE_T FRecentChunkCache::FEntry::GetAllocatedSize() const
+{
+	return GetMeshSize(Surface) + GetMeshSize(Caps) + SurfaceBricks.GetAllocatedSize() + EmptyBricks.GetAllocatedSize()
+		+ Ranges.GetAllocatedSize();
+}
+
+// Memory the entries may use
+void FRecentChunkCache::SetBudget(SIZE_T Bytes)
+{
+	Budget = Bytes;
+	Trim(Budget);
+}
+
+// Keep the data of an unloaded chunk, replacing an older entry of the same key
+void FRecentChunkCache::Add(const FChunkMeshCache::FKey& Key, FEntry&& Entry)
+{
+	FEntry Previous;
+	Take(Key, Previous);
+
+	TotalBytes += Entry.GetAllocatedSize();
+	Entries.Add(Key, MoveTemp(Entry));
+	Order.Add(Key);
+	Trim(Budget);
+}
+
+// Move an entry out of the cache
+bool FRecentChunkCache::Take(const FChunkMeshCache::FKey& Key, FEntry& OutEntry)
+{
+	if (!Entries.RemoveAndCopyValue(Key, OutEntry))
+		return false;
+
+	TotalBytes -= OutEntry.GetAllocatedSize();
+	Order.RemoveSingle(Key);
+	return true;
+}
+
+// Drop the oldest entries until at most TargetBytes are used
+void FRecentChunkCache::Trim(SIZE_T TargetBytes)
+{
+	int32 Dropped = 0;
+	while (TotalBytes > TargetBytes && Dropped < Order.Num())
+	{
+		FEntry Entry;
+		if (Entries.RemoveAndCopyValue(Order[Dropped], Entry))
+		{
+			TotalBytes -= Entry.GetAllocatedSize();
+		}
+		++Dropped;
+	}
+	Order.RemoveAt(0, Dropped);
+
+	if (Entries.Num() == 0)
+	{
+		TotalBytes = 0;
+		Order.Empty();
+	}
+}
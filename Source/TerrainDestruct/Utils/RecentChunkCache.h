@@ -0,0 +1,45 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MeshData.h"
+#include "DensityPyramid.h"
+#include "ChunkMeshCache.h"
+
+// Meshes and density summaries of recently unloaded chunks, kept in memory so a chunk coming back into
+// range is restored without any noise or meshing work. Entries use the keys of the disk cache and are
+// dropped oldest first past the memory budget. Game thread only.
+class FRecentChunkCache
+{
+public:
+	struct FEntry
+	{
+		FSharedMeshData Surface;
+		FSharedMeshData Caps;
+		TBitArray<> SurfaceBricks;
+		TBitArray<> EmptyBricks;
+		FDensityPyramid Ranges;
+
+		SIZE_T GetAllocatedSize() const;
+	};
+
+	// Memory the entries may use, the oldest ones are dropped past it
+	void SetBudget(SIZE_T Bytes);
+
+	// Keep the data of an unloaded chunk, replacing an older entry of the same key
+	void Add(const FChunkMeshCache::FKey& Key, FEntry&& Entry);
+
+	// Move an entry out of the cache, false if there is none
+	bool Take(const FChunkMeshCache::FKey& Key, FEntry& OutEntry);
+
+	// Drop the oldest entries until at most TargetBytes are used
+	void Trim(SIZE_T TargetBytes);
+
+	SIZE_T GetAllocatedSize() const { return TotalBytes; }
+	int32 Num() const { return Entries.Num(); }
+
+private:
+	TMap<FChunkMeshCache::FKey, FEntry> Entries;
+	TArray<FChunkMeshCache::FKey> Order; // oldest first
+	SIZE_T TotalBytes = 0;
+	SIZE_T Budget = 64 * 1024 * 1024;
+};
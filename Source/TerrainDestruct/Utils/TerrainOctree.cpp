@@ -0,0 +1,127 @@
+#include "TerrainOctree.h"
+
+void FTerrainOctree::Configure(int32 InMaxLevel, int32 InSplitDistance, int32 InViewDistance)
+{
+	MaxLevel = FMath::Clamp(InMaxLevel, 0, 16);
+	SplitDistance = FMath::Max(InSplitDistance, 1);
+	ViewDistance = FMath::Max(InViewDistance, 0);
+}
+
+// Rebuild the leaf set around the player chunk, splitting and merging nodes as needed
+void FTerrainOctree::Update(const FIntVector& PlayerChunk)
+{
+	Center = PlayerChunk;
+	Leaves.Reset();
+
+	// Root nodes overlapping the view range (shifting floors negative coordinates too)
+	const FIntVector rootMin(
+		(Center.X - ViewDistance) >> MaxLevel,
+		(Center.Y - ViewDistance) >> MaxLevel,
+		(Center.Z - ViewDistance) >> MaxLevel);
+	const FIntVector rootMax(
+		(Center.X + ViewDistance) >> MaxLevel,
+		(Center.Y + ViewDistance) >> MaxLevel,
+		(Center.Z + ViewDistance) >> MaxLevel);
+
+	for (int32 x = rootMin.X; x <= rootMax.X; ++x)
+	{
+		for (int32 y = rootMin.Y; y <= rootMax.Y; ++y)
+		{
+			for (int32 z = rootMin.Z; z <= rootMax.Z; ++z)
+			{
+				CollectLeaves(FTerrainNodeKey(MaxLevel, FIntVector(x, y, z)));
+			}
+		}
+	}
+}
+
+// Leaf containing a level 0 chunk, false when it is out of view
+bool FTerrainOctree::FindLeaf(const FIntVector& Chunk, FTerrainNodeKey& OutLeaf) const
+{
+	// Walk down from the root containing the chunk until a leaf is found
+	for (int32 level = MaxLevel; level >= 0; --level)
+	{
+		const FTerrainNodeKey node(level, FIntVector(Chunk.X >> level, Chunk.Y >> level, Chunk.Z >> level));
+		if (Leaves.Contains(node))
+		{
+			OutLeaf = node;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Faces (-X, +X, -Y, +Y, -Z, +Z bits) of a leaf touching a leaf of another level
+uint8 FTerrainOctree::GetTransitionFaces(const FTerrainNodeKey& Node) const
+{
+	const int32 span = Node.GetChunkSpan();
+	const FIntVector minChunk = Node.GetMinChunk();
+	uint8 faces = 0;
+
+	for (int32 face = 0; face < 6; ++face)
+	{
+		const int32 axis = face / 2;
+		const int32 uAxis = (axis + 1) % 3;
+		const int32 vAxis = (axis + 2) % 3;
+
+		// Check every chunk just across the face, a finer neighbour may only cover part of it
+		for (int32 u = 0; u < span && (faces & (1 << face)) == 0; ++u)
+		{
+			for (int32 v = 0; v < span; ++v)
+			{
+				FIntVector neighbour = minChunk;
+				neighbour[axis] += (face & 1) ? span : -1;
+				neighbour[uAxis] += u;
+				neighbour[vAxis] += v;
+
+				FTerrainNodeKey leaf;
+				if (FindLeaf(neighbour, leaf) && leaf.Level != Node.Level)
+				{
+					faces |= 1 << face;
+					break;
+				}
+			}
+		}
+	}
+
+	return faces;
+}
+
+// Chebyshev distance in chunks from the player chunk to the chunks covered by a node
+int32 FTerrainOctree::GetDistance(const FTerrainNodeKey& Node) const
+{
+	const FIntVector minChunk = Node.GetMinChunk();
+	const int32 span = Node.GetChunkSpan();
+
+	int32 distance = 0;
+	for (int32 axis = 0; axis < 3; ++axis)
+	{
+		const int32 low = minChunk[axis] - Center[axis];
+		const int32 high = Center[axis] - (minChunk[axis] + span - 1);
+		distance = FMath::Max3(distance, low, high);
+	}
+	return distance;
+}
+
+bool FTerrainOctree::ShouldSplit(const FTerrainNodeKey& Node) const
+{
+	return Node.Level > 0 && GetDistance(Node) < SplitDistance << Node.Level;
+}
+
+void FTerrainOctree::CollectLeaves(const FTerrainNodeKey& Node)
+{
+	// Nothing to load outside the view range
+	if (GetDistance(Node) > ViewDistance)
+		return;
+
+	if (!ShouldSplit(Node))
+	{
+		Leaves.Add(Node);
+		return;
+	}
+
+	for (int32 child = 0; child < 8; ++child)
+	{
+		CollectLeaves(FTerrainNodeKey(Node.Level - 1, Node.Coord * 2 + FIntVector(child & 1, (child >> 1) & 1, (child >> 2) & 1)));
+	}
+}
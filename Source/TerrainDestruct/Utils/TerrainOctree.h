@@ -0,0 +1,63 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// A node of the terrain octree. A node at level L spans 2^L chunks per axis
+// and is meshed at 1/2^L of the full voxel resolution.
+struct FTerrainNodeKey
+{
+	int32 Level = 0;
+	FIntVector Coord = FIntVector::ZeroValue; // in nodes of this level
+
+	FTerrainNodeKey() = default;
+	FTerrainNodeKey(int32 InLevel, const FIntVector& InCoord) : Level(InLevel), Coord(InCoord) {}
+
+	// Number of level 0 chunks covered along each axis
+	int32 GetChunkSpan() const { return 1 << Level; }
+
+	// First level 0 chunk covered by the node
+	FIntVector GetMinChunk() const { return Coord * GetChunkSpan(); }
+
+	bool operator==(const FTerrainNodeKey& Other) const { return Level == Other.Level && Coord == Other.Coord; }
+	bool operator!=(const FTerrainNodeKey& Other) const { return !(*this == Other); }
+
+	friend uint32 GetTypeHash(const FTerrainNodeKey& Key)
+	{
+		return HashCombine(GetTypeHash(Key.Coord), GetTypeHash(Key.Level));
+	}
+};
+
+// Sparse octree of terrain nodes around the player. Nodes close to the player are split
+// down to full resolution chunks, distant space is covered by a few large coarse nodes,
+// so the node count stays bounded however far the view distance goes.
+class FTerrainOctree
+{
+public:
+	// MaxLevel: level of the root nodes. SplitDistance: a node of level L is split while the
+	// player is closer than SplitDistance * 2^L chunks. ViewDistance: radius in chunks.
+	void Configure(int32 InMaxLevel, int32 InSplitDistance, int32 InViewDistance);
+
+	// Rebuild the leaf set around the player chunk, splitting and merging nodes as needed
+	void Update(const FIntVector& PlayerChunk);
+
+	// Nodes that should currently hold a chunk
+	const TSet<FTerrainNodeKey>& GetLeaves() const { return Leaves; }
+
+	// Leaf containing a level 0 chunk, false when it is out of view
+	bool FindLeaf(const FIntVector& Chunk, FTerrainNodeKey& OutLeaf) const;
+
+	// Faces (-X, +X, -Y, +Y, -Z, +Z bits) of a leaf touching a leaf of another level
+	uint8 GetTransitionFaces(const FTerrainNodeKey& Node) const;
+
+private:
+	// Chebyshev distance in chunks from the player chunk to the chunks covered by a node
+	int32 GetDistance(const FTerrainNodeKey& Node) const;
+	bool ShouldSplit(const FTerrainNodeKey& Node) const;
+	void CollectLeaves(const FTerrainNodeKey& Node);
+
+	int32 MaxLevel = 0;
+	int32 SplitDistance = 1;
+	int32 ViewDistance = 0;
+	FIntVector Center = FIntVector::ZeroValue;
+	TSet<FTerrainNodeKey> Leaves;
+};
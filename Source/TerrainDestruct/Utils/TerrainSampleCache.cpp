@@ -0,0 +1,61 @@
+#include "TerrainSampleCache.h"
+
+FTerrainSampleCache::FTerrainSampleCache(int32 InMaxColumns, int32 InMaxFaces)
+	: MaxColumns(FMath::Max(InMaxColumns, 1))
+	, MaxFaces(FMath::Max(InMaxFaces, 1))
+{
+}
+
+// Heights of a column, Generate fills them on the first request
+FTerrainSampleCache::FColumnRef FTerrainSampleCache::GetColumn(const FIntVector& Key, TFunctionRef<void(TArray<float>&)> Generate)
+{
+	{
+		FScopeLock ScopeLock(&Lock);
+		if (const FColumnRef* Column = Columns.Find(Key))
+		{
+			return *Column;
+		}
+	}
+
+	// Generate outside the lock, two jobs may race on the same column and the first one to finish wins
+	TSharedRef<TArray<float>, ESPMode::ThreadSafe> Heights = MakeShared<TArray<float>, ESPMode::ThreadSafe>();
+	Generate(*Heights);
+
+	FScopeLock ScopeLock(&Lock);
+	if (const FColumnRef* Column = Columns.Find(Key))
+	{
+		return *Column;
+	}
+
+	Columns.Add(Key, Heights);
+	ColumnOrder.Add(Key);
+	while (ColumnOrder.Num() > MaxColumns)
+	{
+		// Jobs still holding an evicted column keep it alive through their reference
+		Columns.Remove(ColumnOrder[0]);
+		ColumnOrder.RemoveAt(0, EAllowShrinking::No);
+	}
+	return Heights;
+}
+
+// Move the samples of a face published by a neighbour into Out
+bool FTerrainSampleCache::TakeFace(const FFaceKey& Key, TArray<float>& Out)
+{
+	FScopeLock ScopeLock(&Lock);
+	return Faces.RemoveAndCopyValue(Key, Out);
+}
+
+// Publish the samples of a face for the neighbour on the other side
+void FTerrainSampleCache::AddFace(const FFaceKey& Key, TArray<float>&& Samples)
+{
+	FScopeLock ScopeLock(&Lock);
+	Faces.Add(Key, MoveTemp(Samples));
+	FaceOrder.Add(Key);
+
+	// Faces whose neighbour never came, or was generated at the same time, are dropped eventually
+	while (FaceOrder.Num() > MaxFaces)
+	{
+		Faces.Remove(FaceOrder[0]);
+		FaceOrder.RemoveAt(0, EAllowShrinking::No);
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Noise samples shared between the chunks of the terrain, read and filled by mesh jobs on any thread.
+// Columns hold the 2D heights of the heightfield density, shared by every chunk stacked along Z.
+// Faces hold the border layer a chunk sampled, taken by the neighbour of the same level that samples it next.
+// Both are bounded, the oldest entries are dropped first.
+class FTerrainSampleCache
+{
+public:
+	typedef TSharedRef<const TArray<float>, ESPMode::ThreadSafe> FColumnRef;
+
+	// Key of a border face: noise space origin of the face, axis it is orthogonal to and sample spacing
+	struct FFaceKey
+	{
+		FIntVector Origin = FIntVector::ZeroValue;
+		int32 Axis = 0;
+		int32 Stride = 1;
+
+		bool operator==(const FFaceKey& Other) const { return Origin == Other.Origin && Axis == Other.Axis && Stride == Other.Stride; }
+
+		friend uint32 GetTypeHash(const FFaceKey& Key)
+		{
+			return HashCombine(GetTypeHash(Key.Origin), HashCombine(GetTypeHash(Key.Axis), GetTypeHash(Key.Stride)));
+		}
+	};
+
+	explicit FTerrainSampleCache(int32 InMaxColumns = 1024, int32 InMaxFaces = 2048);
+
+	// Heights of a column (noise space X, Y origin and stride), Generate fills them on the first request
+	FColumnRef GetColumn(const FIntVector& Key, TFunctionRef<void(TArray<float>&)> Generate);
+
+	// Move the samples of a face published by a neighbour into Out, false if there are none
+	bool TakeFace(const FFaceKey& Key, TArray<float>& Out);
+
+	// Publish the samples of a face for the neighbour on the other side
+	void AddFace(const FFaceKey& Key, TArray<float>&& Samples);
+
+private:
+	FCriticalSection Lock;
+
+	int32 MaxColumns;
+	TMap<FIntVector, FColumnRef> Columns;
+	TArray<FIntVector> ColumnOrder; // oldest first
+
+	int32 MaxFaces;
+	TMap<FFaceKey, TArray<float>> Faces;
+	TArray<FFaceKey> FaceOrder; // oldest first, may still list faces already taken
+};
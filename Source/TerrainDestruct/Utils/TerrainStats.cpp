@@ -0,0 +1,35 @@
+#include "TerrainStats.h"
+
+DEFINE_STAT(STAT_TerrainTick);
+DEFINE_STAT(STAT_TerrainUpdateOctree);
+DEFINE_STAT(STAT_TerrainSpawnChunks);
+DEFINE_STAT(STAT_TerrainGatherEdits);
+DEFINE_STAT(STAT_TerrainModifyVoxel);
+DEFINE_STAT(STAT_TerrainApplyMesh);
+DEFINE_STAT(STAT_TerrainUpdateSection);
+DEFINE_STAT(STAT_TerrainUpdateCollision);
+DEFINE_STAT(STAT_TerrainLoadEdits);
+
+DEFINE_STAT(STAT_TerrainGenerateDensity);
+DEFINE_STAT(STAT_TerrainAcquireDensity);
+DEFINE_STAT(STAT_TerrainDensitySummaries);
+DEFINE_STAT(STAT_TerrainGenerateMesh);
+DEFINE_STAT(STAT_TerrainMarch);
+DEFINE_STAT(STAT_TerrainTransitionCaps);
+DEFINE_STAT(STAT_TerrainMeshCacheLoad);
+DEFINE_STAT(STAT_TerrainMeshCacheSave);
+DEFINE_STAT(STAT_TerrainSaveEdits);
+
+DEFINE_STAT(STAT_TerrainUploadSection);
+
+DEFINE_STAT(STAT_TerrainLoadedChunks);
+DEFINE_STAT(STAT_TerrainPendingChunks);
+DEFINE_STAT(STAT_TerrainDeferredChunks);
+DEFINE_STAT(STAT_TerrainRetiringChunks);
+DEFINE_STAT(STAT_TerrainRecentChunks);
+DEFINE_STAT(STAT_TerrainMeshJobs);
+
+DEFINE_STAT(STAT_TerrainEditEntries);
+DEFINE_STAT(STAT_TerrainVoxelMemory);
+DEFINE_STAT(STAT_TerrainMeshMemory);
+DEFINE_STAT(STAT_TerrainRecentChunkMemory);
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+// Stats of the terrain pipeline, shown in game with "stat Terrain".
+// Every stage with a cycle counter also opens a trace scope of the same name for Unreal Insights captures.
+DECLARE_STATS_GROUP(TEXT("Terrain"), STATGROUP_Terrain, STATCAT_Advanced);
+
+// Game thread
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Tick"), STAT_TerrainTick, STATGROUP_Terrain, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Update Octree"), STAT_TerrainUpdateOctree, STATGROUP_Terrain, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Spawn Chunks"), STAT_TerrainSpawnChunks, STATGROUP_Terrain, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Modify Voxel"), STAT_TerrainModifyVoxel, STATGROUP_Terrain, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Apply Mesh"), STAT_TerrainApplyMesh, STATGROUP_Terrain, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Update Section"), STAT_TerrainUpdateSection, STATGROUP_Terrain, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Update Collision"), STAT_TerrainUpdateCollision, STATGROUP_Terrain, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Load Edits"), STAT_TerrainLoadEdits, STATGROUP_Terrain, );
+
+// Mesh jobs
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Generate Density"), STAT_TerrainGenerateDensity, STATGROUP_Terrain, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Acquire Density"), STAT_TerrainAcquireDensity, STATGROUP_Terrain, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Density Summaries"), STAT_TerrainDensitySummaries, STATGROUP_Terrain, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Generate Mesh"), STAT_TerrainGenerateMesh, STATGROUP_Terrain, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("March"), STAT_TerrainMarch, STATGROUP_Terrain, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Transition Caps"), STAT_TerrainTransitionCaps, STATGROUP_Terrain, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Mesh Cache Load"), STAT_TerrainMeshCacheLoad, STATGROUP_Terrain, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Mesh Cache Save"), STAT_TerrainMeshCacheSave, STATGROUP_Terrain, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Save Edits"), STAT_TerrainSaveEdits, STATGROUP_Terrain, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Gather Edits"), STAT_TerrainGatherEdits, STATGROUP_Terrain, );
+
+// Render thread
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Upload Section"), STAT_TerrainUploadSection, STATGROUP_Terrain, );
+
+// Queues, set every terrain tick
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Loaded Chunks"), STAT_TerrainLoadedChunks, STATGROUP_Terrain, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Pending Chunks"), STAT_TerrainPendingChunks, STATGROUP_Terrain, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Deferred Chunks"), STAT_TerrainDeferredChunks, STATGROUP_Terrain, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Retiring Chunks"), STAT_TerrainRetiringChunks, STATGROUP_Terrain, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Recent Chunks"), STAT_TerrainRecentChunks, STATGROUP_Terrain, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Mesh Jobs"), STAT_TerrainMeshJobs, STATGROUP_Terrain, );
+
+// Memory, kept up to date by the chunks
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Edit Entries"), STAT_TerrainEditEntries, STATGROUP_Terrain, );
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Voxel Memory"), STAT_TerrainVoxelMemory, STATGROUP_Terrain, );
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Mesh Memory"), STAT_TerrainMeshMemory, STATGROUP_Terrain, );
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Recent Chunk Memory"), STAT_TerrainRecentChunkMemory, STATGROUP_Terrain, );
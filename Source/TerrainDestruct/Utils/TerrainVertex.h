@@ -0,0 +1,44 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Compact vertex stream of the terrain meshes: float positions relative to the chunk,
+// normals octahedral encoded as two 16-bit snorm values packed in a uint32
+namespace TerrainVertex
+{
+	// Project the unit normal onto the octahedron |x| + |y| + |z| = 1 and fold the lower half over the upper one
+	inline uint32 PackNormal(const FVector3f& Normal)
+	{
+		const float length = FMath::Abs(Normal.X) + FMath::Abs(Normal.Y) + FMath::Abs(Normal.Z);
+		if (length < UE_SMALL_NUMBER)
+			return PackNormal(FVector3f::UpVector);
+
+		float u = Normal.X / length;
+		float v = Normal.Y / length;
+		if (Normal.Z < 0.0f)
+		{
+			const float foldedU = (1.0f - FMath::Abs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+			const float foldedV = (1.0f - FMath::Abs(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+			u = foldedU;
+			v = foldedV;
+		}
+
+		const int16 packedU = (int16)FMath::RoundToInt(FMath::Clamp(u, -1.0f, 1.0f) * 32767.0f);
+		const int16 packedV = (int16)FMath::RoundToInt(FMath::Clamp(v, -1.0f, 1.0f) * 32767.0f);
+		return (uint32)(uint16)packedU | ((uint32)(uint16)packedV << 16);
+	}
+
+	// Unit normal of a packed octahedral normal
+	inline FVector3f UnpackNormal(uint32 Packed)
+	{
+		const float u = (int16)(Packed & 0xFFFF) / 32767.0f;
+		const float v = (int16)(Packed >> 16) / 32767.0f;
+
+		// Unfold the lower half of the octahedron
+		FVector3f normal(u, v, 1.0f - FMath::Abs(u) - FMath::Abs(v));
+		const float fold = FMath::Max(-normal.Z, 0.0f);
+		normal.X += normal.X >= 0.0f ? -fold : fold;
+		normal.Y += normal.Y >= 0.0f ? -fold : fold;
+		return normal.GetSafeNormal(UE_SMALL_NUMBER, FVector3f::UpVector);
+	}
+}
@@ -0,0 +1,43 @@
+#include "TerrainWorldConfig.h"
+
+// Configure the noise generators and compute the hash, once every field is set
+void FTerrainWorldConfig::Finalize()
+{
+	Noise.SetSeed(Seed);
+	Noise.SetFrequency(Frequency);
+	Noise.SetNoiseType(NoiseType);
+	Noise.SetFractalType(FastNoiseLite::FractalType_FBm);
+	Noise.SetFractalOctaves(Octaves);
+	Noise.SetFractalLacunarity(Lacunarity);
+	Noise.SetFractalGain(Gain);
+
+	DetailNoise.SetSeed(Seed + 1);
+	DetailNoise.SetFrequency(Frequency * 4.0f);
+	DetailNoise.SetNoiseType(NoiseType);
+	DetailNoise.SetFractalType(FastNoiseLite::FractalType_None);
+
+	// Only fields with a stable hash across sessions (no pointers)
+	Hash = GetTypeHash(GeneratorVersion);
+	Hash = HashCombine(Hash, GetTypeHash(Seed));
+	Hash = HashCombine(Hash, GetTypeHash((int32)NoiseType));
+	Hash = HashCombine(Hash, GetTypeHash(Frequency));
+	Hash = HashCombine(Hash, GetTypeHash(Octaves));
+	Hash = HashCombine(Hash, GetTypeHash(Lacunarity));
+	Hash = HashCombine(Hash, GetTypeHash(Gain));
+	Hash = HashCombine(Hash, GetTypeHash(SurfaceLevel));
+	Hash = HashCombine(Hash, GetTypeHash(ChunkSize));
+	Hash = HashCombine(Hash, GetTypeHash(bHeightfieldDensity));
+	if (bHeightfieldDensity)
+	{
+		Hash = HashCombine(Hash, GetTypeHash(HeightAmplitude));
+		Hash = HashCombine(Hash, GetTypeHash(DetailAmplitude));
+	}
+}
+
+// True when the fields added with the config keep their defaults, the chunks used to hardcode them
+bool FTerrainWorldConfig::IsLegacyWorld() const
+{
+	const FTerrainWorldConfig Defaults;
+	return Seed == Defaults.Seed && NoiseType == Defaults.NoiseType && Octaves == Defaults.Octaves
+		&& Lacunarity == Defaults.Lacunarity && Gain == Defaults.Gain;
+}
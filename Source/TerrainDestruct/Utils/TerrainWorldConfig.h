@@ -0,0 +1,45 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FastNoiseLite.h"
+
+// Everything that decides the generated density of the world. The terrain builds it once and every chunk
+// and mesh job reads it through the same pointer, it never changes afterwards so no locking is needed.
+// The hash keys the save files and caches, so data produced under
+// another config is never reused.
+struct FTerrainWorldConfig
+{
+	// Bump when the density function changes, to invalidate everything keyed by the hash
+	static constexpr uint32 GeneratorVersion = 1;
+
+	int32 Seed = 1337;
+	FastNoiseLite::NoiseType NoiseType = FastNoiseLite::NoiseType_Perlin;
+	float Frequency = 0.03f;
+	int32 Octaves = 3;
+	float Lacunarity = 2.0f;
+	float Gain = 0.5f;
+	float SurfaceLevel = 0.0f;
+	int32 ChunkSize = 16; // voxels per axis of a full resolution chunk
+
+	// Heightfield density, see ChunkDensity::GenerateRegion
+	bool bHeightfieldDensity = false;
+	float HeightAmplitude = 32.0f;
+	float DetailAmplitude = 0.3f;
+
+	// Configured by Finalize. GetNoise only reads the generator but isn't declared const
+	mutable FastNoiseLite Noise; // fractal noise of the density, or of the heights in heightfield mode
+	mutable FastNoiseLite DetailNoise; // single octave of finer noise added to the heightfield
+	uint32 Hash = 0;
+
+	// Configure the noise generators and compute the hash, once every field is set
+	void Finalize();
+
+	// True when the fields added with the config keep their defaults: the world is the one generated before
+	// the config existed, whose saves were written to the legacy save root
+	bool IsLegacyWorld() const;
+
+	// Hash as 8 hex digits, for file and directory names
+	FString GetHashString() const { return FString::Printf(TEXT("%08x"), Hash); }
+};
+
+typedef TSharedPtr<const FTerrainWorldConfig, ESPMode::ThreadSafe> FTerrainWorldConfigPtr;
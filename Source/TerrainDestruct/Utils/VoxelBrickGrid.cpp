@@ -0,0 +1,175 @@
+#include "VoxelBrickGrid.h"
+
+namespace
+{
+	// A brick whose values all lie within this range is stored as a single value
+	constexpr float UniformTolerance = 1.0f / 8192.0f;
+
+	// Largest error allowed when storing a brick as 8-bit values (half a quantization step)
+	constexpr float MaxQuantizationError = 1.0f / 1024.0f;
+}
+
+// Compress a dense grid laid out as Z * Dim * Dim + Y * Dim + X
+void FVoxelBrickGrid::Compress(const TArray<float>& Dense, int32 InDim)
+{
+	check(Dense.Num() == InDim * InDim * InDim);
+
+	Reset();
+	Dim = InDim;
+	BricksPerAxis = FMath::DivideAndRoundUp(Dim, BrickSize);
+	Bricks.SetNum(BricksPerAxis * BricksPerAxis * BricksPerAxis);
+
+	for (int32 BZ = 0; BZ < BricksPerAxis; ++BZ)
+	{
+		for (int32 BY = 0; BY < BricksPerAxis; ++BY)
+		{
+			for (int32 BX = 0; BX < BricksPerAxis; ++BX)
+			{
+				int32 X0, X1, Y0, Y1, Z0, Z1;
+				GetBrickRange(BX, X0, X1);
+				GetBrickRange(BY, Y0, Y1);
+				GetBrickRange(BZ, Z0, Z1);
+
+				// Find the value range of the brick to pick its encoding
+				float Min = MAX_flt;
+				float Max = -MAX_flt;
+				for (int32 Z = Z0; Z < Z1; ++Z)
+				{
+					for (int32 Y = Y0; Y < Y1; ++Y)
+					{
+						const float* Row = &Dense[(Z * Dim + Y) * Dim];
+						for (int32 X = X0; X < X1; ++X)
+						{
+							Min = FMath::Min(Min, Row[X]);
+							Max = FMath::Max(Max, Row[X]);
+						}
+					}
+				}
+
+				FBrick& Brick = Bricks[GetBrickIndex(BX, BY, BZ)];
+				Brick.Min = Min;
+
+				if (Max - Min <= UniformTolerance)
+				{
+					// Store the middle of the range so the error stays under half the tolerance
+					Brick.Encoding = EBrickEncoding::Uniform;
+					Brick.Min = (Min + Max) * 0.5f;
+				}
+				else if ((Max - Min) / 255.0f * 0.5f <= MaxQuantizationError)
+				{
+					Brick.Encoding = EBrickEncoding::Quantized8;
+					Brick.Scale = (Max - Min) / 255.0f;
+					Brick.DataOffset = Quantized.Num();
+
+					for (int32 Z = Z0; Z < Z1; ++Z)
+					{
+						for (int32 Y = Y0; Y < Y1; ++Y)
+						{
+							const float* Row = &Dense[(Z * Dim + Y) * Dim];
+							for (int32 X = X0; X < X1; ++X)
+							{
+								Quantized.Add((uint8)FMath::Clamp(FMath::RoundToInt((Row[X] - Min) / Brick.Scale), 0, 255));
+							}
+						}
+					}
+				}
+				else
+				{
+					Brick.Encoding = EBrickEncoding::Raw;
+					Brick.DataOffset = Raw.Num();
+
+					for (int32 Z = Z0; Z < Z1; ++Z)
+					{
+						for (int32 Y = Y0; Y < Y1; ++Y)
+						{
+							Raw.Append(&Dense[(Z * Dim + Y) * Dim + X0], X1 - X0);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	Quantized.Shrink();
+	Raw.Shrink();
+}
+
+// Expand the whole grid back into a dense scratch buffer for meshing
+void FVoxelBrickGrid::Decompress(TArray<float>& OutDense) const
+{
+	OutDense.SetNumUninitialized(Dim * Dim * Dim, EAllowShrinking::No);
+
+	for (int32 BZ = 0; BZ < BricksPerAxis; ++BZ)
+	{
+		for (int32 BY = 0; BY < BricksPerAxis; ++BY)
+		{
+			for (int32 BX = 0; BX < BricksPerAxis; ++BX)
+			{
+				int32 X0, X1, Y0, Y1, Z0, Z1;
+				GetBrickRange(BX, X0, X1);
+				GetBrickRange(BY, Y0, Y1);
+				GetBrickRange(BZ, Z0, Z1);
+
+				const FBrick& Brick = Bricks[GetBrickIndex(BX, BY, BZ)];
+				int32 Source = Brick.DataOffset;
+
+				for (int32 Z = Z0; Z < Z1; ++Z)
+				{
+					for (int32 Y = Y0; Y < Y1; ++Y)
+					{
+						float* Row = &OutDense[(Z * Dim + Y) * Dim];
+						switch (Brick.Encoding)
+						{
+						case EBrickEncoding::Uniform:
+							for (int32 X = X0; X < X1; ++X)
+							{
+								Row[X] = Brick.Min;
+							}
+							break;
+
+						case EBrickEncoding::Quantized8:
+							for (int32 X = X0; X < X1; ++X)
+							{
+								Row[X] = Brick.Min + Quantized[Source++] * Brick.Scale;
+							}
+							break;
+
+						case EBrickEncoding::Raw:
+							FMemory::Memcpy(Row + X0, &Raw[Source], (X1 - X0) * sizeof(float));
+							Source += X1 - X0;
+							break;
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+// Release all stored bricks
+void FVoxelBrickGrid::Reset()
+{
+	Dim = 0;
+	BricksPerAxis = 0;
+	Bricks.Empty();
+	Quantized.Empty();
+	Raw.Empty();
+}
+
+// Memory used by the compressed representation
+SIZE_T FVoxelBrickGrid::GetAllocatedSize() const
+{
+	return Bricks.GetAllocatedSize() + Quantized.GetAllocatedSize() + Raw.GetAllocatedSize();
+}
+
+// Voxel range covered by a brick along one axis
+void FVoxelBrickGrid::GetBrickRange(int32 BrickCoord, int32& OutStart, int32& OutEnd) const
+{
+	OutStart = BrickCoord * BrickSize;
+	OutEnd = FMath::Min(OutStart + BrickSize, Dim);
+}
+
+int32 FVoxelBrickGrid::GetBrickIndex(int32 BX, int32 BY, int32 BZ) const
+{
+	return (BZ * BricksPerAxis + BY) * BricksPerAxis + BX;
+}
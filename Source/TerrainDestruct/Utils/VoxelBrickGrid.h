@@ -0,0 +1,53 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Compressed resident storage for a chunk's (Dim)^3 density grid.
+// The grid is split into 8^3 bricks, each stored as a single uniform value,
+// 8-bit values quantized between the brick's min and max, or raw floats.
+class FVoxelBrickGrid
+{
+public:
+	static constexpr int32 BrickSize = 8;
+
+	// Compress a dense grid laid out as Z * Dim * Dim + Y * Dim + X
+	void Compress(const TArray<float>& Dense, int32 InDim);
+
+	// Expand the whole grid back into a dense scratch buffer for meshing
+	void Decompress(TArray<float>& OutDense) const;
+
+	// Release all stored bricks
+	void Reset();
+
+	bool IsEmpty() const { return Bricks.Num() == 0; }
+	int32 GetDim() const { return Dim; }
+
+	// Memory used by the compressed representation
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	enum class EBrickEncoding : uint8
+	{
+		Uniform,	// Every voxel has the value Min
+		Quantized8,	// Min + byte * Scale
+		Raw			// Plain floats
+	};
+
+	struct FBrick
+	{
+		EBrickEncoding Encoding = EBrickEncoding::Uniform;
+		float Min = 0.0f;
+		float Scale = 0.0f;
+		int32 DataOffset = 0;	// Offset into Quantized or Raw depending on the encoding
+	};
+
+	// Voxel range covered by a brick along one axis
+	void GetBrickRange(int32 BrickCoord, int32& OutStart, int32& OutEnd) const;
+	int32 GetBrickIndex(int32 BX, int32 BY, int32 BZ) const;
+
+	int32 Dim = 0;
+	int32 BricksPerAxis = 0;
+	TArray<FBrick> Bricks;
+	TArray<uint8> Quantized;
+	TArray<float> Raw;
+};
@@ -0,0 +1,49 @@
+#include "VoxelEditBricks.h"
+
+// Add a density delta to a voxel
+void FVoxelEditBricks::Add(const FIntVector& Voxel, float Delta)
+{
+	GetWritableValue(Voxel) += Delta;
+}
+
+// Overwrite the delta of a voxel
+void FVoxelEditBricks::Set(const FIntVector& Voxel, float Value)
+{
+	GetWritableValue(Voxel) = Value;
+}
+
+// Delta of a voxel, 0 when it was never modified
+float FVoxelEditBricks::Get(const FIntVector& Voxel) const
+{
+	const TSharedPtr<FBrick, ESPMode::ThreadSafe>* Brick = Bricks.Find(GetBrickCoord(Voxel));
+	return Brick ? (*Brick)->Values[GetLocalIndex(Voxel)] : 0.0f;
+}
+
+// Brick of the voxel, cloned first if another copy of the set still points to it
+float& FVoxelEditBricks::GetWritableValue(const FIntVector& Voxel)
+{
+	TSharedPtr<FBrick, ESPMode::ThreadSafe>& Brick = Bricks.FindOrAdd(GetBrickCoord(Voxel));
+	if (!Brick.IsValid())
+	{
+		Brick = MakeShared<FBrick, ESPMode::ThreadSafe>();
+	}
+	else if (!Brick.IsUnique())
+	{
+		// A snapshot is reading this version, write into a new one
+		Brick = MakeShared<FBrick, ESPMode::ThreadSafe>(*Brick);
+	}
+
+	return Brick->Values[GetLocalIndex(Voxel)];
+}
+
+FIntVector FVoxelEditBricks::GetBrickCoord(const FIntVector& Voxel)
+{
+	// Shifting floors the division, edits around the chunk border can have negative coordinates
+	return FIntVector(Voxel.X >> BrickShift, Voxel.Y >> BrickShift, Voxel.Z >> BrickShift);
+}
+
+int32 FVoxelEditBricks::GetLocalIndex(const FIntVector& Voxel)
+{
+	const FIntVector Local = Voxel - GetBrickCoord(Voxel) * BrickSize;
+	return (Local.Z * BrickSize + Local.Y) * BrickSize + Local.X;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Density modifications of a chunk stored as copy-on-write bricks of 8^3 voxels.
+// Copying the set only copies brick pointers. A brick still shared with a copy is cloned
+// before it is written, so mesh jobs read an immutable version without locks while the
+// game thread keeps editing, and every edit is visible to the next copy taken.
+class FVoxelEditBricks
+{
+public:
+	static constexpr int32 BrickShift = 3;
+	static constexpr int32 BrickSize = 1 << BrickShift;
+
+	// Add a density delta to a voxel (full resolution voxel coordinates, may lie outside the chunk)
+	void Add(const FIntVector& Voxel, float Delta);
+
+	// Overwrite the delta of a voxel
+	void Set(const FIntVector& Voxel, float Value);
+
+	// Delta of a voxel, 0 when it was never modified
+	float Get(const FIntVector& Voxel) const;
+
+	void Reset() { Bricks.Reset(); }
+	bool IsEmpty() const { return Bricks.Num() == 0; }
+
+	// Call Func(Voxel, Delta) for every modified voxel
+	template<typename FuncType>
+	void ForEach(FuncType&& Func) const
+	{
+		for (const auto& Pair : Bricks)
+		{
+			const FIntVector Origin = Pair.Key * BrickSize;
+			for (int32 Index = 0; Index < BrickVoxels; ++Index)
+			{
+				const float Delta = Pair.Value->Values[Index];
+				if (Delta != 0.0f)
+				{
+					Func(Origin + FIntVector(Index % BrickSize, (Index / BrickSize) % BrickSize, Index / (BrickSize * BrickSize)), Delta);
+				}
+			}
+		}
+	}
+
+private:
+	static constexpr int32 BrickVoxels = BrickSize * BrickSize * BrickSize;
+
+	struct FBrick
+	{
+		float Values[BrickVoxels] = {};
+	};
+
+	// Brick of the voxel, cloned first if another copy of the set still points to it
+	float& GetWritableValue(const FIntVector& Voxel);
+
+	static FIntVector GetBrickCoord(const FIntVector& Voxel);
+	static int32 GetLocalIndex(const FIntVector& Voxel);
+
+	TMap<FIntVector, TSharedPtr<FBrick, ESPMode::ThreadSafe>> Bricks;
+};